@@ -0,0 +1,33 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <cstdint>
+#include <functional>
+
+// Time source for everything that waits: reconnect backoff, the notification
+// watchdog and the sleeps between reclaim steps. The daemon uses SystemClock,
+// the simulator uses VirtualClock to run days of activity in milliseconds.
+class Clock {
+public:
+    using TimerId = uint64_t;
+
+    virtual ~Clock() = default;
+
+    // Wall clock, milliseconds since the epoch
+    virtual int64_t nowMs() const = 0;
+
+    // Monotonic clock for measuring durations
+    virtual int64_t monotonicUs() const = 0;
+
+    // Block the caller (and the event loop) for the given time
+    virtual void sleepMs(int64_t ms) = 0;
+
+    // Run callback after intervalMs, once or every intervalMs until cancelled.
+    // Returns a non-zero id.
+    virtual TimerId startTimer(int64_t intervalMs, std::function<void()> callback, bool singleShot = true) = 0;
+
+    // Cancelling an unknown or already fired single-shot timer is a no-op
+    virtual void cancelTimer(TimerId id) = 0;
+};
+
+#endif // CLOCK_H
@@ -0,0 +1,59 @@
+#include "systemclock.h"
+
+#include <QDateTime>
+#include <QThread>
+#include <QTimer>
+
+SystemClock::SystemClock()
+{
+    monotonic.start();
+}
+
+SystemClock::~SystemClock()
+{
+    qDeleteAll(timers);
+}
+
+int64_t SystemClock::nowMs() const
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+int64_t SystemClock::monotonicUs() const
+{
+    return monotonic.nsecsElapsed() / 1000;
+}
+
+void SystemClock::sleepMs(int64_t ms)
+{
+    QThread::msleep(static_cast<unsigned long>(ms));
+}
+
+Clock::TimerId SystemClock::startTimer(int64_t intervalMs, std::function<void()> callback, bool singleShot)
+{
+    TimerId id = nextTimerId++;
+
+    QTimer *timer = new QTimer();
+    timer->setSingleShot(singleShot);
+    QObject::connect(timer, &QTimer::timeout, timer, [this, id, singleShot, callback = std::move(callback)]() {
+        // Drop single-shot timers before running the callback so it can start a new one
+        if (singleShot) {
+            if (QTimer *fired = timers.take(id)) {
+                fired->deleteLater();
+            }
+        }
+        callback();
+    });
+    timers.insert(id, timer);
+    timer->start(static_cast<int>(intervalMs));
+
+    return id;
+}
+
+void SystemClock::cancelTimer(TimerId id)
+{
+    if (QTimer *timer = timers.take(id)) {
+        timer->stop();
+        timer->deleteLater();
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef SYSTEMCLOCK_H
+#define SYSTEMCLOCK_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include "clock.h"
+
+class QTimer;
+
+// Real time, timers run on the Qt event loop of the calling thread
+class SystemClock : public Clock {
+public:
+    SystemClock();
+    ~SystemClock() override;
+
+    int64_t nowMs() const override;
+    int64_t monotonicUs() const override;
+    void sleepMs(int64_t ms) override;
+    TimerId startTimer(int64_t intervalMs, std::function<void()> callback, bool singleShot = true) override;
+    void cancelTimer(TimerId id) override;
+
+private:
+    QElapsedTimer monotonic;
+    QHash<TimerId, QTimer *> timers;
+    TimerId nextTimerId = 1;
+};
+
+#endif // SYSTEMCLOCK_H
@@ -0,0 +1,79 @@
+#include "virtualclock.h"
+
+VirtualClock::VirtualClock(int64_t startMs)
+    : start(startMs), now(startMs)
+{
+}
+
+void VirtualClock::sleepMs(int64_t ms)
+{
+    if (ms > 0) {
+        now += ms;
+    }
+}
+
+Clock::TimerId VirtualClock::startTimer(int64_t intervalMs, std::function<void()> callback, bool singleShot)
+{
+    TimerId id = nextTimerId++;
+    if (intervalMs < 0) {
+        intervalMs = 0;
+    }
+    timers.emplace(std::make_pair(now + intervalMs, id), Timer{intervalMs, singleShot, std::move(callback)});
+    return id;
+}
+
+void VirtualClock::cancelTimer(TimerId id)
+{
+    for (auto it = timers.begin(); it != timers.end(); ++it) {
+        if (it->first.second == id) {
+            timers.erase(it);
+            return;
+        }
+    }
+}
+
+void VirtualClock::advance(int64_t ms)
+{
+    int64_t target = now + ms;
+    while (!timers.empty() && timers.begin()->first.first <= target) {
+        fire(timers.begin());
+    }
+    if (now < target) {
+        now = target;
+    }
+}
+
+bool VirtualClock::runNextTimer()
+{
+    if (timers.empty()) {
+        return false;
+    }
+    fire(timers.begin());
+    return true;
+}
+
+int64_t VirtualClock::nextDeadline() const
+{
+    return timers.empty() ? -1 : timers.begin()->first.first;
+}
+
+void VirtualClock::fire(std::map<std::pair<int64_t, TimerId>, Timer>::iterator it)
+{
+    int64_t deadline = it->first.first;
+    TimerId id = it->first.second;
+    Timer timer = std::move(it->second);
+    timers.erase(it);
+
+    // An earlier callback that slept may have pushed us past the deadline
+    if (now < deadline) {
+        now = deadline;
+    }
+
+    // Re-arm repeating timers before the callback so it can cancel them
+    if (!timer.singleShot) {
+        int64_t interval = timer.intervalMs > 0 ? timer.intervalMs : 1;
+        timers.emplace(std::make_pair(now + interval, id), Timer{timer.intervalMs, false, timer.callback});
+    }
+
+    timer.callback();
+}
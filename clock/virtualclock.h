@@ -0,0 +1,48 @@
+#ifndef VIRTUALCLOCK_H
+#define VIRTUALCLOCK_H
+
+#include <map>
+#include <utility>
+#include "clock.h"
+
+// Simulated time. Nothing happens until the owner advances the clock; timers
+// then fire in deadline order (ties in start order) with now() set to their
+// deadline. sleepMs() just moves time forward without firing timers, the same
+// way a blocking sleep stalls the real event loop.
+class VirtualClock : public Clock {
+public:
+    explicit VirtualClock(int64_t startMs = 1700000000000);
+
+    int64_t nowMs() const override { return now; }
+    int64_t monotonicUs() const override { return (now - start) * 1000; }
+    void sleepMs(int64_t ms) override;
+    TimerId startTimer(int64_t intervalMs, std::function<void()> callback, bool singleShot = true) override;
+    void cancelTimer(TimerId id) override;
+
+    // Fire every timer due up to now + ms, then leave now at now + ms
+    void advance(int64_t ms);
+
+    // Jump to the next timer deadline and fire it; false if nothing is pending
+    bool runNextTimer();
+
+    // Deadline of the earliest pending timer, -1 if none
+    int64_t nextDeadline() const;
+
+    size_t pendingTimers() const { return timers.size(); }
+
+private:
+    struct Timer {
+        int64_t intervalMs;
+        bool singleShot;
+        std::function<void()> callback;
+    };
+
+    void fire(std::map<std::pair<int64_t, TimerId>, Timer>::iterator it);
+
+    int64_t start;
+    int64_t now;
+    TimerId nextTimerId = 1;
+    std::map<std::pair<int64_t, TimerId>, Timer> timers;  // (deadline, id) -> timer
+};
+
+#endif // VIRTUALCLOCK_H
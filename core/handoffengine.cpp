@@ -0,0 +1,353 @@
+#include "handoffengine.h"
+
+#include <algorithm>
+#include <string>
+#include "metrics/metrics.h"
+#include "status/statuspage.h"
+
+HandoffEngine::HandoffEngine(const Packets::Bytes &localMac, Transport &transport, AudioBackend &audio, Clock &clock,
+                             LogSink &log, Metrics::Registry &metrics, StatusPage::Writer *status)
+    : localMac(localMac), transport(transport), audio(audio), clock(clock), log(log), metrics(metrics), status(status)
+{
+}
+
+HandoffEngine::~HandoffEngine()
+{
+    clock.cancelTimer(keepaliveTimer);
+    clock.cancelTimer(reconnectTimer);
+}
+
+void HandoffEngine::start()
+{
+    // Setup keepalive timer to detect dead connections
+    keepaliveTimer = clock.startTimer(KEEPALIVE_INTERVAL, [this]() { checkNotificationHealth(); }, false);
+
+    // Connect to AirPods
+    connect();
+}
+
+int HandoffEngine::reconnectDelay(int attempt)
+{
+    // Clamp the shift, a long outage would otherwise overflow it
+    return std::min(RECONNECT_BASE_DELAY << std::min(attempt, 4), RECONNECT_MAX_DELAY);
+}
+
+void HandoffEngine::onConnected()
+{
+    log.info("[Handoff] Connected to AirPods");
+
+    // Reset reconnection state on successful connection
+    attempts = 0;
+    clock.cancelTimer(reconnectTimer);
+    reconnectTimer = 0;
+
+    if (disconnectedAtUs > 0) {
+        metrics.reconnectLatency.observeUs(clock.monotonicUs() - disconnectedAtUs);
+        disconnectedAtUs = 0;
+    }
+
+    if (status) {
+        status->current().connectionState = StatusPage::CONNECTED;
+        publishStatus();
+    }
+
+    // The watchdog covers the handshake too: a link that goes silent before
+    // FEATURES_ACK would otherwise never be checked
+    lastNotification = clock.nowMs();
+
+    // Send handshake
+    transport.send(Packets::Connection::HANDSHAKE);
+
+    // Don't request notifications yet - wait for FEATURES_ACK
+}
+
+void HandoffEngine::onPacket(const Packets::Bytes &data)
+{
+    // Handle FEATURES_ACK - send REQUEST_NOTIFICATIONS after receiving this
+    if (Packets::startsWith(data, Packets::Connection::FEATURES_ACK)) {
+        log.info("[Handoff] Received FEATURES_ACK - requesting notifications");
+        transport.send(Packets::Connection::REQUEST_NOTIFICATIONS);
+
+        // Start tracking notification health from now
+        lastNotification = clock.nowMs();
+        return;
+    }
+
+    // Parse AUDIO_SOURCE packets
+    if (!Packets::startsWith(data, Packets::AudioSource::HEADER)) {
+        return;
+    }
+
+    int64_t handoffStarted = clock.monotonicUs();
+
+    auto newSource = Packets::AudioSource::parse(data);
+    if (!newSource.isValid) {
+        return;
+    }
+
+    switch (newSource.type) {
+        case Packets::AudioSource::NONE:
+            metrics.audioSourceNone.inc();
+            break;
+        case Packets::AudioSource::CALL:
+            metrics.audioSourceCall.inc();
+            break;
+        default:
+            metrics.audioSourceMedia.inc();
+    }
+
+    // Update last notification time
+    lastNotification = clock.nowMs();
+    if (status) {
+        status->current().audioSourceNotifications++;
+    }
+
+    const char *typeStr = (newSource.type == Packets::AudioSource::NONE) ? "NONE" :
+                          (newSource.type == Packets::AudioSource::CALL) ? "CALL" : "MEDIA";
+    log.info("[Handoff] Audio source: " + Packets::toHex(newSource.deviceMac) + " (" + typeStr + ")");
+
+    // Check if another device took audio from us
+    bool weHadAudio = source.isValid &&
+                     source.type != Packets::AudioSource::NONE &&
+                     source.deviceMac == localMac;
+
+    bool otherDeviceHasAudio = newSource.type != Packets::AudioSource::NONE &&
+                              newSource.deviceMac != localMac;
+
+    // Handle NONE: if another device took audio from us and then released it, reclaim
+    if (newSource.type == Packets::AudioSource::NONE) {
+        if (reclaimOnNone) {
+            log.info("[Handoff] Another device released audio - reclaiming");
+
+            if (transport.isConnected()) {
+                sendClaim();
+                audio.reclaimAudioStream();
+                recordHandoff(handoffStarted);
+            }
+
+            reclaimOnNone = false;  // Reset flag
+        }
+    }
+    // Another device has audio
+    else if (otherDeviceHasAudio) {
+        // If we had audio and another device took it, pause and mark for reclaim
+        if (weHadAudio) {
+            log.info("[Handoff] Another device took audio from us - pausing Linux");
+            audio.pauseAllMedia();
+            reclaimOnNone = true;  // Reclaim when they release
+        }
+        // If Linux has any active audio (MPRIS or Discord/games), mark for reclaim
+        else if (audio.isMediaPlaying() || audio.hasActiveAudio()) {
+            log.info("[Handoff] Another device has audio and Linux has active audio - marking for reclaim");
+            audio.pauseAllMedia();  // Try to pause MPRIS players if any
+            reclaimOnNone = true;  // Reclaim when they release
+        }
+    }
+
+    // Remember last non-NONE source
+    if (newSource.type != Packets::AudioSource::NONE) {
+        source = newSource;
+    }
+
+    updateOwnerStatus(newSource);
+    publishStatus();
+}
+
+void HandoffEngine::onPlaybackStarted()
+{
+    int64_t handoffStarted = clock.monotonicUs();
+
+    // If socket is not connected, we can't do handoff - just try to force reclaim audio
+    if (!transport.isConnected()) {
+        log.info("[Handoff] Playback started but socket disconnected - forcing audio reclaim");
+        audio.reclaimAudioStream();
+        recordHandoff(handoffStarted);
+        publishStatus();
+        return;
+    }
+
+    // Check if we need to reclaim audio
+    if (source.isValid) {
+        if (source.type == Packets::AudioSource::NONE) {
+            log.info("[Handoff] Playback started - no device has audio");
+            // Proactively claim ownership
+            int64_t written = sendClaim();
+            if (written == -1) {
+                log.error("[Handoff] Failed to send OWNS_CONNECTION");
+            }
+            publishStatus();
+            return;
+        }
+
+        log.info("[Handoff] Comparing MACs - Current: " + Packets::toHex(source.deviceMac) +
+                 ", Local: " + Packets::toHex(localMac));
+
+        if (source.deviceMac == localMac) {
+            log.info("[Handoff] We already own audio, no handoff needed");
+            return;
+        }
+
+        log.info("[Handoff] Another device has audio - reclaiming");
+    } else {
+        log.info("[Handoff] Playback started - no AUDIO_SOURCE info yet, claiming proactively");
+    }
+
+    // Claim ownership and reclaim audio stream
+    log.info("[Handoff] Sending OWNS_CONNECTION (claim)");
+    int64_t written = sendClaim();
+    if (written == -1) {
+        log.error("[Handoff] Failed to send OWNS_CONNECTION");
+    }
+
+    // Reclaim audio stream
+    audio.reclaimAudioStream();
+    recordHandoff(handoffStarted);
+    publishStatus();
+}
+
+void HandoffEngine::onDisconnected()
+{
+    log.error("[Handoff] Socket disconnected!");
+
+    // Clear state since we can't get updates anymore
+    source = Packets::AudioSource::Info{Packets::Bytes(), Packets::AudioSource::NONE, false};
+    reclaimOnNone = false;
+    lastNotification = 0;  // Reset notification tracking
+
+    // Reconnect latency counts from the first loss, not from each failed retry
+    if (disconnectedAtUs == 0) {
+        disconnectedAtUs = clock.monotonicUs();
+    }
+
+    if (status) {
+        status->current().connectionState = StatusPage::DISCONNECTED;
+        status->current().ownerValid = 0;
+        status->current().ownerIsLocal = 0;
+        status->current().disconnects++;
+        publishStatus();
+    }
+
+    scheduleReconnect();
+}
+
+void HandoffEngine::onConnectFailed()
+{
+    // Errors during an active connection trigger onDisconnected instead
+    metrics.connectFailures.inc();
+
+    // Nothing is in flight while we back off
+    if (status) {
+        status->current().connectionState = StatusPage::DISCONNECTED;
+        publishStatus();
+    }
+
+    scheduleReconnect();
+}
+
+void HandoffEngine::checkNotificationHealth()
+{
+    // If socket is not connected, nothing to check
+    if (!transport.isConnected()) {
+        return;
+    }
+
+    // Check if we've received any notifications recently (5 minutes threshold)
+    int64_t now = clock.nowMs();
+    int64_t timeSinceLastNotification = now - lastNotification;
+
+    if (lastNotification > 0 && timeSinceLastNotification > NOTIFICATION_TIMEOUT) {
+        log.error("[Handoff] No notifications for " + std::to_string(timeSinceLastNotification / 60000) +
+                  " minutes - socket may be dead");
+        log.info("[Handoff] Forcing socket reconnection...");
+
+        // Force disconnect and reconnect
+        transport.disconnectFromAirPods();
+    }
+}
+
+void HandoffEngine::connect()
+{
+    log.info("[Handoff] Connecting to AirPods...");
+
+    if (status) {
+        status->current().connectionState = StatusPage::CONNECTING;
+        publishStatus();
+    }
+
+    transport.connectToAirPods();
+}
+
+void HandoffEngine::scheduleReconnect()
+{
+    // Don't schedule reconnection if already scheduled
+    if (reconnectTimer) {
+        return;
+    }
+
+    int delay = reconnectDelay(attempts);
+    attempts++;
+
+    log.info("[Handoff] Scheduling reconnection in " + std::to_string(delay / 1000) +
+             "s (attempt " + std::to_string(attempts) + ")");
+
+    // Try to reconnect after delay
+    reconnectTimer = clock.startTimer(delay, [this]() {
+        reconnectTimer = 0;
+        log.info("[Handoff] Attempting to reconnect...");
+        metrics.reconnectAttempts.inc();
+        if (status) {
+            status->current().reconnectAttempts++;
+        }
+        connect();
+    });
+}
+
+int64_t HandoffEngine::sendClaim()
+{
+    int64_t written = transport.send(Packets::OwnsConnection::CLAIM);
+    if (written == -1) {
+        metrics.claimFailures.inc();
+        return written;
+    }
+
+    metrics.claimsSent.inc();
+    if (status) {
+        status->current().claimsSent++;
+    }
+    return written;
+}
+
+void HandoffEngine::recordHandoff(int64_t startedUs)
+{
+    int64_t elapsedUs = clock.monotonicUs() - startedUs;
+    metrics.handoffLatency.observeUs(elapsedUs);
+
+    if (status) {
+        status->current().lastHandoffUs = elapsedUs;
+        status->current().handoffs++;
+    }
+}
+
+void HandoffEngine::updateOwnerStatus(const Packets::AudioSource::Info &info)
+{
+    if (!status) {
+        return;
+    }
+
+    StatusPage::Snapshot &current = status->current();
+    current.ownerValid = 1;
+    current.ownerType = info.type;
+    current.ownerIsLocal = info.type != Packets::AudioSource::NONE && info.deviceMac == localMac;
+
+    // AUDIO_SOURCE carries the MAC reversed, store it in display order
+    for (int i = 0; i < 6; i++) {
+        current.ownerMac[i] = info.deviceMac[5 - i];
+    }
+}
+
+void HandoffEngine::publishStatus()
+{
+    if (status) {
+        status->publish(clock.nowMs());
+    }
+}
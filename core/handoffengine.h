@@ -0,0 +1,110 @@
+#ifndef HANDOFFENGINE_H
+#define HANDOFFENGINE_H
+
+#include "log.h"
+#include "packets.h"
+#include "clock/clock.h"
+
+namespace Metrics {
+    struct Registry;
+}
+
+namespace StatusPage {
+    class Writer;
+}
+
+// Ownership and reclaim state machine.
+//
+// Plain C++ with no Qt: the daemon feeds it socket and playback events and
+// carries out its decisions through the Transport and AudioBackend interfaces.
+// All waiting goes through the Clock, so the simulator can drive it in
+// virtual time, all output goes to a LogSink and all counters to the given
+// Metrics::Registry (the daemon passes Metrics::registry()).
+class HandoffEngine {
+public:
+    // Packet link to the AirPods
+    class Transport {
+    public:
+        virtual ~Transport() = default;
+
+        virtual bool isConnected() const = 0;
+
+        // Returns the number of bytes written or -1
+        virtual int64_t send(const Packets::Bytes &packet) = 0;
+
+        // Results are reported back through onConnected()/onConnectFailed()
+        virtual void connectToAirPods() = 0;
+        virtual void disconnectFromAirPods() = 0;
+    };
+
+    // Local audio stack
+    class AudioBackend {
+    public:
+        virtual ~AudioBackend() = default;
+
+        virtual void reclaimAudioStream() = 0;
+        virtual void pauseAllMedia() = 0;
+        virtual bool isMediaPlaying() = 0;
+        virtual bool hasActiveAudio() = 0;
+    };
+
+    static constexpr int KEEPALIVE_INTERVAL = 60 * 1000;          // Health check every 60 seconds
+    static constexpr int64_t NOTIFICATION_TIMEOUT = 5 * 60 * 1000;  // 5 minutes
+    static constexpr int RECONNECT_BASE_DELAY = 2000;
+    static constexpr int RECONNECT_MAX_DELAY = 30000;
+
+    HandoffEngine(const Packets::Bytes &localMac, Transport &transport, AudioBackend &audio, Clock &clock,
+                  LogSink &log, Metrics::Registry &metrics, StatusPage::Writer *status = nullptr);
+    ~HandoffEngine();
+
+    HandoffEngine(const HandoffEngine &) = delete;
+    HandoffEngine &operator=(const HandoffEngine &) = delete;
+
+    // Start the keepalive timer and connect
+    void start();
+
+    void onConnected();
+    void onPacket(const Packets::Bytes &data);
+    void onPlaybackStarted();
+    void onDisconnected();
+
+    // A connection attempt failed in a way worth retrying
+    void onConnectFailed();
+
+    void checkNotificationHealth();
+
+    const Packets::AudioSource::Info &currentSource() const { return source; }
+    bool shouldReclaimOnNone() const { return reclaimOnNone; }
+    int reconnectAttempts() const { return attempts; }
+    bool isReconnectScheduled() const { return reconnectTimer != 0; }
+    int64_t lastNotificationTime() const { return lastNotification; }
+
+    // Backoff before the given reconnection attempt (2s, 4s, 8s, max 30s)
+    static int reconnectDelay(int attempt);
+
+private:
+    void connect();
+    void scheduleReconnect();
+    int64_t sendClaim();
+    void recordHandoff(int64_t startedUs);
+    void updateOwnerStatus(const Packets::AudioSource::Info &info);
+    void publishStatus();
+
+    Packets::Bytes localMac;
+    Transport &transport;
+    AudioBackend &audio;
+    Clock &clock;
+    LogSink &log;
+    Metrics::Registry &metrics;
+    StatusPage::Writer *status;
+
+    Packets::AudioSource::Info source{Packets::Bytes(), Packets::AudioSource::NONE, false};
+    bool reclaimOnNone = false;  // Set to true when another device takes audio from us
+    int attempts = 0;  // Track reconnection attempts for exponential backoff
+    Clock::TimerId reconnectTimer = 0;  // Timer for reconnection attempts
+    Clock::TimerId keepaliveTimer = 0;  // Timer to check notification health
+    int64_t lastNotification = 0;  // Timestamp of last received AUDIO_SOURCE notification
+    int64_t disconnectedAtUs = 0;  // When the connection was lost, for reconnect latency
+};
+
+#endif // HANDOFFENGINE_H
@@ -0,0 +1,16 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <string>
+
+// Destination for core log lines. The daemon prints them with a wall clock
+// timestamp, the simulator with virtual time or not at all.
+class LogSink {
+public:
+    virtual ~LogSink() = default;
+
+    virtual void info(const std::string &message) = 0;
+    virtual void error(const std::string &message) = 0;
+};
+
+#endif // LOG_H
@@ -0,0 +1,82 @@
+#include "packets.h"
+
+#include <algorithm>
+
+namespace Packets {
+
+bool startsWith(const Bytes &data, const Bytes &prefix)
+{
+    return data.size() >= prefix.size() && std::equal(prefix.begin(), prefix.end(), data.begin());
+}
+
+std::string toHex(const Bytes &data)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    std::string hex;
+    hex.reserve(data.size() * 2);
+    for (uint8_t byte : data) {
+        hex.push_back(digits[byte >> 4]);
+        hex.push_back(digits[byte & 0x0f]);
+    }
+    return hex;
+}
+
+namespace OwnsConnection {
+
+const Bytes HEADER = {0x04, 0x00, 0x04, 0x00, 0x09, 0x00};
+
+Bytes createCommand(uint8_t identifier, uint8_t data1)
+{
+    Bytes packet = HEADER;
+    packet.push_back(identifier);
+    packet.push_back(data1);
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+    return packet;
+}
+
+const Bytes CLAIM = createCommand(0x06, 0x01);
+const Bytes RELEASE = createCommand(0x06, 0x00);
+
+}
+
+namespace AudioSource {
+
+const Bytes HEADER = {0x04, 0x00, 0x04, 0x00, 0x0E};
+
+Info parse(const Bytes &data)
+{
+    Info info{Bytes(), NONE, false};
+
+    // Format: 04 00 04 00 0E [1 byte] [6 bytes MAC] [1 byte type]
+    if (data.size() >= 13 && startsWith(data, HEADER)) {
+        info.deviceMac.assign(data.begin() + 6, data.begin() + 12);
+        info.type = static_cast<Type>(data[12]);
+        info.isValid = true;
+    }
+
+    return info;
+}
+
+Bytes create(const Bytes &deviceMac, Type type)
+{
+    Bytes packet = HEADER;
+    packet.push_back(0x00);
+    packet.insert(packet.end(), deviceMac.begin(), deviceMac.begin() + std::min<size_t>(deviceMac.size(), 6));
+    packet.push_back(type);
+    return packet;
+}
+
+}
+
+namespace Connection {
+
+const Bytes HANDSHAKE = {0x00, 0x00, 0x04, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+const Bytes REQUEST_NOTIFICATIONS = {0x04, 0x00, 0x04, 0x00, 0x0f, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff};
+const Bytes FEATURES_ACK = {0x04, 0x00, 0x04, 0x00, 0x2b, 0x00};
+
+}
+
+}
@@ -0,0 +1,52 @@
+#ifndef PACKETS_H
+#define PACKETS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Packets {
+    using Bytes = std::vector<uint8_t>;
+
+    bool startsWith(const Bytes &data, const Bytes &prefix);
+    std::string toHex(const Bytes &data);
+
+    // AACP Control Command - OWNS_CONNECTION
+    namespace OwnsConnection {
+        extern const Bytes HEADER;
+
+        Bytes createCommand(uint8_t identifier, uint8_t data1);
+
+        extern const Bytes CLAIM;
+        extern const Bytes RELEASE;
+    }
+
+    // TiPi Protocol - Audio Source (tells which device is playing)
+    namespace AudioSource {
+        extern const Bytes HEADER;
+
+        enum Type : uint8_t {
+            NONE = 0x00,
+            CALL = 0x01,
+            MEDIA = 0x02
+        };
+
+        struct Info {
+            Bytes deviceMac;
+            Type type;
+            bool isValid;
+        };
+
+        Info parse(const Bytes &data);
+        Bytes create(const Bytes &deviceMac, Type type);
+    }
+
+    // Connection handshake packets
+    namespace Connection {
+        extern const Bytes HANDSHAKE;
+        extern const Bytes REQUEST_NOTIFICATIONS;
+        extern const Bytes FEATURES_ACK;
+    }
+}
+
+#endif // PACKETS_H
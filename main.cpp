@@ -1,369 +1,231 @@
 #include <QCoreApplication>
-#include <QBluetoothSocket>
 #include <QBluetoothLocalDevice>
-#include <QBluetoothUuid>
 #include <QBluetoothAddress>
-#include <QTimer>
 #include <QDateTime>
+#include <cstring>
 #include <iostream>
-#include "packets.h"
+#include "clock/systemclock.h"
+#include "core/handoffengine.h"
+#include "core/log.h"
 #include "media/mediacontroller.h"
+#include "metrics/metrics.h"
+#include "metrics/metricsserver.h"
+#include "status/statuspage.h"
+#include "transport/bluetoothtransport.h"
+#include "transport/l2captransport.h"
 
 QString getTimestamp() {
     return QDateTime::currentDateTime().toString("HH:mm:ss.zzz");
 }
 
-class AirPodsHandoff : public QObject {
+// Core log lines go to the console with a wall clock timestamp
+class ConsoleLog : public LogSink {
+public:
+    void info(const std::string &message) override {
+        std::cout << "[" << getTimestamp().toStdString() << "] " << message << std::endl;
+    }
+
+    void error(const std::string &message) override {
+        std::cerr << "[" << getTimestamp().toStdString() << "] " << message << std::endl;
+    }
+};
+
+struct Options {
+    QString airpodsMac;
+    bool rawL2cap = false;  // Raw L2CAP socket instead of QBluetoothSocket
+    L2capTransport::Options l2cap;
+    QString metricsSocket;  // Serve metrics on this Unix socket, off when empty
+    QString statusFile;     // Status page location, defaults to $XDG_RUNTIME_DIR
+};
+
+// Adapts the handoff engine to the Qt transports and the media controller
+class AirPodsHandoff : public QObject, private HandoffEngine::Transport, private HandoffEngine::AudioBackend {
     Q_OBJECT
 
 public:
-    AirPodsHandoff(const QString &airpodsMac, QObject *parent = nullptr)
-        : QObject(parent), airpodsMac(airpodsMac)
+    AirPodsHandoff(const Options &options, QObject *parent = nullptr)
+        : QObject(parent), airpodsMac(options.airpodsMac), localMac(readLocalMac()),
+          status(options.statusFile.isEmpty() ? StatusPage::defaultPath() : options.statusFile.toStdString()),
+          engine(toBytes(localMac), *this, *this, clock, log, Metrics::registry(), &status)
     {
-        // Get local Bluetooth MAC for comparison
-        QBluetoothLocalDevice localDevice;
-        QBluetoothAddress localAddr = localDevice.address();
-        localMac = QByteArray::fromHex(localAddr.toString().replace(":", "").toLatin1());
-        std::reverse(localMac.begin(), localMac.end());
-
         std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Local MAC (reversed): " << localMac.toHex().toStdString() << std::endl;
 
+        if (status.isOpen()) {
+            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Status page: " << status.filePath() << std::endl;
+        } else {
+            std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] Status page disabled: " << status.errorString() << std::endl;
+        }
+
+        if (options.rawL2cap) {
+            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Using raw L2CAP transport" << std::endl;
+            transport = new L2capTransport(clock, options.l2cap, this);
+        } else {
+            transport = new BluetoothTransport(this);
+        }
+
+        connect(transport, &::Transport::connected, this, &AirPodsHandoff::onConnected);
+        connect(transport, &::Transport::packetReceived, this, &AirPodsHandoff::onPacketReceived);
+        connect(transport, &::Transport::disconnected, this, &AirPodsHandoff::onDisconnected);
+        connect(transport, &::Transport::connectFailed, this, &AirPodsHandoff::onConnectFailed);
+
         // Initialize media controller
         QString deviceMac = QString(airpodsMac).replace(":", "_");
-        media = new MediaController(deviceMac, this);
+        media = new MediaController(deviceMac, clock, this);
         connect(media, &MediaController::playbackStarted, this, &AirPodsHandoff::onPlaybackStarted);
 
-        // Setup keepalive timer to detect dead connections
-        keepaliveTimer = new QTimer(this);
-        connect(keepaliveTimer, &QTimer::timeout, this, &AirPodsHandoff::checkNotificationHealth);
-        keepaliveTimer->start(60000);  // Check every 60 seconds
-
-        // Connect to AirPods
-        connectToAirPods();
+        // Start the keepalive timer and connect to AirPods
+        engine.start();
     }
 
-    bool isSocketConnected() const {
-        return socket && socket->isOpen() && socket->state() == QBluetoothSocket::SocketState::ConnectedState;
+    ~AirPodsHandoff() override {
+        // The transport may hold timers on our clock, drop it before the clock goes away
+        delete transport;
     }
 
 private slots:
     void onConnected() {
-        std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Connected to AirPods" << std::endl;
-
-        // Reset reconnection state on successful connection
-        reconnectAttempts = 0;
-        if (reconnectTimer) {
-            reconnectTimer->stop();
-            reconnectTimer->deleteLater();
-            reconnectTimer = nullptr;
-        }
-
-        // Send handshake
-        socket->write(Packets::Connection::HANDSHAKE);
-
-        // Don't request notifications yet - wait for FEATURES_ACK
+        engine.onConnected();
     }
 
-    void onDataReceived() {
-        QByteArray data = socket->readAll();
-
-        // Debug: log all received data (commented out - uncomment for debugging)
-        // if (data.size() > 0) {
-        //     std::cout << "[Handoff] Received packet: " << data.toHex().toStdString() << std::endl;
-        // }
-
-        // Handle FEATURES_ACK - send REQUEST_NOTIFICATIONS after receiving this
-        if (data.startsWith(Packets::Connection::FEATURES_ACK)) {
-            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Received FEATURES_ACK - requesting notifications" << std::endl;
-            socket->write(Packets::Connection::REQUEST_NOTIFICATIONS);
-
-            // Start tracking notification health from now
-            lastNotificationTime = QDateTime::currentMSecsSinceEpoch();
-            return;
-        }
-
-        // Parse AUDIO_SOURCE packets
-        if (data.startsWith(Packets::AudioSource::HEADER)) {
-            auto newSource = Packets::AudioSource::parse(data);
-            if (newSource.isValid) {
-                // Update last notification time
-                lastNotificationTime = QDateTime::currentMSecsSinceEpoch();
-
-                QString typeStr = (newSource.type == Packets::AudioSource::NONE) ? "NONE" :
-                                (newSource.type == Packets::AudioSource::CALL) ? "CALL" : "MEDIA";
-                std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Audio source: " << newSource.deviceMac.toHex().toStdString()
-                         << " (" << typeStr.toStdString() << ")" << std::endl;
-
-                // Check if another device took audio from us
-                bool weHadAudio = currentSource.isValid &&
-                                 currentSource.type != Packets::AudioSource::NONE &&
-                                 currentSource.deviceMac == localMac;
-
-                bool otherDeviceHasAudio = newSource.type != Packets::AudioSource::NONE &&
-                                          newSource.deviceMac != localMac;
-
-                // Handle NONE: if another device took audio from us and then released it, reclaim
-                if (newSource.type == Packets::AudioSource::NONE) {
-                    if (shouldReclaimOnNone) {
-                        std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Another device released audio - reclaiming" << std::endl;
-
-                        if (socket && socket->isOpen()) {
-                            socket->write(Packets::OwnsConnection::CLAIM);
-                            media->reclaimAudioStream();
-                        }
-
-                        shouldReclaimOnNone = false;  // Reset flag
-                    }
-                }
-                // Another device has audio
-                else if (otherDeviceHasAudio) {
-                    // If we had audio and another device took it, pause and mark for reclaim
-                    if (weHadAudio) {
-                        std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Another device took audio from us - pausing Linux" << std::endl;
-                        media->pauseAllMedia();
-                        shouldReclaimOnNone = true;  // Reclaim when they release
-                    }
-                    // If Linux has any active audio (MPRIS or Discord/games), mark for reclaim
-                    else if (media->isMediaPlaying() || media->hasActiveAudio()) {
-                        std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Another device has audio and Linux has active audio - marking for reclaim" << std::endl;
-                        media->pauseAllMedia();  // Try to pause MPRIS players if any
-                        shouldReclaimOnNone = true;  // Reclaim when they release
-                    }
-                }
-
-                // Remember last non-NONE source
-                if (newSource.type != Packets::AudioSource::NONE) {
-                    currentSource = newSource;
-                }
-            }
-        }
+    void onPacketReceived(const QByteArray &packet) {
+        engine.onPacket(toBytes(packet));
     }
 
     void onPlaybackStarted() {
-        // If socket is not connected, we can't do handoff - just try to force reclaim audio
-        if (!isSocketConnected()) {
-            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Playback started but socket disconnected - forcing audio reclaim" << std::endl;
-            media->reclaimAudioStream();
-            return;
-        }
-
-        // Check if we need to reclaim audio
-        if (currentSource.isValid) {
-            if (currentSource.type == Packets::AudioSource::NONE) {
-                std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Playback started - no device has audio" << std::endl;
-                // Proactively claim ownership
-                qint64 written = socket->write(Packets::OwnsConnection::CLAIM);
-                if (written == -1) {
-                    std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] Failed to send OWNS_CONNECTION" << std::endl;
-                }
-                return;
-            }
-
-            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Comparing MACs - Current: " << currentSource.deviceMac.toHex().toStdString()
-                     << ", Local: " << localMac.toHex().toStdString() << std::endl;
-
-            if (currentSource.deviceMac == localMac) {
-                std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] We already own audio, no handoff needed" << std::endl;
-                return;
-            }
-
-            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Another device has audio - reclaiming" << std::endl;
-        } else {
-            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Playback started - no AUDIO_SOURCE info yet, claiming proactively" << std::endl;
-        }
-
-        // Claim ownership and reclaim audio stream
-        std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Sending OWNS_CONNECTION (claim)" << std::endl;
-        qint64 written = socket->write(Packets::OwnsConnection::CLAIM);
-        if (written == -1) {
-            std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] Failed to send OWNS_CONNECTION" << std::endl;
-        }
-
-        // Reclaim audio stream
-        media->reclaimAudioStream();
+        engine.onPlaybackStarted();
     }
 
     void onDisconnected() {
-        std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] Socket disconnected!" << std::endl;
-
-        // Clear state since we can't get updates anymore
-        currentSource = Packets::AudioSource::Info();
-        shouldReclaimOnNone = false;
-        lastNotificationTime = 0;  // Reset notification tracking
-
-        // Don't schedule reconnection if already scheduled
-        if (reconnectTimer) {
-            return;
-        }
-
-        // Calculate exponential backoff delay (2s, 4s, 8s, max 30s)
-        int delay = std::min(2000 * (1 << reconnectAttempts), 30000);
-        reconnectAttempts++;
-
-        std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Scheduling reconnection in "
-                 << delay / 1000 << "s (attempt " << reconnectAttempts << ")" << std::endl;
-
-        // Try to reconnect after delay
-        reconnectTimer = new QTimer(this);
-        reconnectTimer->setSingleShot(true);
-        connect(reconnectTimer, &QTimer::timeout, this, [this]() {
-            reconnectTimer->deleteLater();
-            reconnectTimer = nullptr;
-            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Attempting to reconnect..." << std::endl;
-            connectToAirPods();
-        });
-        reconnectTimer->start(delay);
+        engine.onDisconnected();
     }
 
-    void checkNotificationHealth() {
-        // If socket is not connected, nothing to check
-        if (!isSocketConnected()) {
-            return;
-        }
-
-        // Check if we've received any notifications recently (5 minutes threshold)
-        qint64 now = QDateTime::currentMSecsSinceEpoch();
-        qint64 timeSinceLastNotification = now - lastNotificationTime;
-        const qint64 NOTIFICATION_TIMEOUT = 5 * 60 * 1000;  // 5 minutes
-
-        if (lastNotificationTime > 0 && timeSinceLastNotification > NOTIFICATION_TIMEOUT) {
-            std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] No notifications for "
-                     << timeSinceLastNotification / 60000 << " minutes - socket may be dead" << std::endl;
-            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Forcing socket reconnection..." << std::endl;
-
-            // Force disconnect and reconnect
-            if (socket) {
-                socket->disconnectFromService();
-            }
-        }
+    void onConnectFailed() {
+        engine.onConnectFailed();
     }
 
-    void onStateChanged(QBluetoothSocket::SocketState state) {
-        QString stateStr;
-        switch (state) {
-            case QBluetoothSocket::SocketState::UnconnectedState:
-                stateStr = "Unconnected";
-                break;
-            case QBluetoothSocket::SocketState::ServiceLookupState:
-                stateStr = "ServiceLookup";
-                break;
-            case QBluetoothSocket::SocketState::ConnectingState:
-                stateStr = "Connecting";
-                break;
-            case QBluetoothSocket::SocketState::ConnectedState:
-                stateStr = "Connected";
-                break;
-            case QBluetoothSocket::SocketState::ClosingState:
-                stateStr = "Closing";
-                break;
-            default:
-                stateStr = "Unknown";
-        }
-        std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Socket state: " << stateStr.toStdString() << std::endl;
+private:
+    static QByteArray readLocalMac() {
+        // Get local Bluetooth MAC for comparison
+        QBluetoothLocalDevice localDevice;
+        QBluetoothAddress localAddr = localDevice.address();
+        QByteArray mac = QByteArray::fromHex(localAddr.toString().replace(":", "").toLatin1());
+        std::reverse(mac.begin(), mac.end());
+        return mac;
     }
 
-    void onError(QBluetoothSocket::SocketError error) {
-        std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] Socket error: " << static_cast<int>(error);
-
-        // Log error type for debugging
-        switch (error) {
-            case QBluetoothSocket::SocketError::ServiceNotFoundError:
-                std::cerr << " (ServiceNotFoundError)" << std::endl;
-                break;
-            case QBluetoothSocket::SocketError::HostNotFoundError:
-                std::cerr << " (HostNotFoundError)" << std::endl;
-                break;
-            case QBluetoothSocket::SocketError::NetworkError:
-                std::cerr << " (NetworkError)" << std::endl;
-                break;
-            case QBluetoothSocket::SocketError::UnknownSocketError:
-                std::cerr << " (UnknownSocketError)" << std::endl;
-                break;
-            default:
-                std::cerr << std::endl;
-        }
-
-        // If we get an error during connection attempt, schedule reconnection
-        // (errors during active connection will trigger onDisconnected instead)
-        if (error == QBluetoothSocket::SocketError::ServiceNotFoundError ||
-            error == QBluetoothSocket::SocketError::HostNotFoundError ||
-            error == QBluetoothSocket::SocketError::NetworkError) {
+    // HandoffEngine::Transport
+    bool isConnected() const override {
+        return transport->isConnected();
+    }
 
-            // Don't retry if already scheduled
-            if (reconnectTimer) {
-                return;
-            }
+    int64_t send(const Packets::Bytes &packet) override {
+        return transport->send(toQByteArray(packet));
+    }
 
-            // Calculate exponential backoff delay (2s, 4s, 8s, max 30s)
-            int delay = std::min(2000 * (1 << reconnectAttempts), 30000);
-            reconnectAttempts++;
-
-            std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Scheduling reconnection in "
-                     << delay / 1000 << "s (attempt " << reconnectAttempts << ")" << std::endl;
-
-            reconnectTimer = new QTimer(this);
-            reconnectTimer->setSingleShot(true);
-            connect(reconnectTimer, &QTimer::timeout, this, [this]() {
-                reconnectTimer->deleteLater();
-                reconnectTimer = nullptr;
-                std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Attempting to reconnect..." << std::endl;
-                connectToAirPods();
-            });
-            reconnectTimer->start(delay);
-        }
+    void connectToAirPods() override {
+        transport->connectToDevice(airpodsMac);
     }
 
-private:
-    void connectToAirPods() {
-        std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Connecting to AirPods..." << std::endl;
+    void disconnectFromAirPods() override {
+        transport->disconnectFromDevice();
+    }
 
-        // Clean up old socket if it exists
-        if (socket) {
-            socket->disconnect();
-            socket->deleteLater();
-        }
+    // HandoffEngine::AudioBackend
+    void reclaimAudioStream() override {
+        media->reclaimAudioStream();
+    }
 
-        socket = new QBluetoothSocket(QBluetoothServiceInfo::L2capProtocol, this);
+    void pauseAllMedia() override {
+        media->pauseAllMedia();
+    }
 
-        connect(socket, &QBluetoothSocket::connected, this, &AirPodsHandoff::onConnected);
-        connect(socket, &QBluetoothSocket::readyRead, this, &AirPodsHandoff::onDataReceived);
-        connect(socket, &QBluetoothSocket::disconnected, this, &AirPodsHandoff::onDisconnected);
-        connect(socket, QOverload<QBluetoothSocket::SocketError>::of(&QBluetoothSocket::errorOccurred),
-                this, &AirPodsHandoff::onError);
-        connect(socket, &QBluetoothSocket::stateChanged, this, &AirPodsHandoff::onStateChanged);
+    bool isMediaPlaying() override {
+        return media->isMediaPlaying();
+    }
 
-        // Connect to AirPods AACP service
-        QBluetoothAddress addr(airpodsMac);
-        socket->connectToService(addr, QBluetoothUuid("74ec2172-0bad-4d01-8f77-997b2be0722a"));
+    bool hasActiveAudio() override {
+        return media->hasActiveAudio();
     }
 
     QString airpodsMac;
     QByteArray localMac;
-    QBluetoothSocket *socket = nullptr;
+    SystemClock clock;
+    ConsoleLog log;
+    StatusPage::Writer status;  // Shared-memory status page for status bars
+    ::Transport *transport = nullptr;  // Qt transport, not HandoffEngine::Transport
     MediaController *media = nullptr;
-    Packets::AudioSource::Info currentSource;
-    bool shouldReclaimOnNone = false;  // Set to true when another device takes audio from us
-    int reconnectAttempts = 0;  // Track reconnection attempts for exponential backoff
-    QTimer *reconnectTimer = nullptr;  // Timer for reconnection attempts
-    QTimer *keepaliveTimer = nullptr;  // Timer to check notification health
-    qint64 lastNotificationTime = 0;  // Timestamp of last received AUDIO_SOURCE notification
+    HandoffEngine engine;
 };
 
+static bool parseOptions(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--transport") == 0 && hasValue) {
+            QString name = QString(argv[++i]);
+            if (name != "qt" && name != "l2cap") {
+                return false;
+            }
+            options.rawL2cap = name == "l2cap";
+        } else if (std::strcmp(arg, "--rcvbuf") == 0 && hasValue) {
+            options.l2cap.receiveBufferSize = QString(argv[++i]).toInt();
+        } else if (std::strcmp(arg, "--sndbuf") == 0 && hasValue) {
+            options.l2cap.sendBufferSize = QString(argv[++i]).toInt();
+        } else if (std::strcmp(arg, "--connect-timeout") == 0 && hasValue) {
+            options.l2cap.connectTimeoutMs = QString(argv[++i]).toInt();
+        } else if (std::strcmp(arg, "--batch") == 0 && hasValue) {
+            options.l2cap.batchSize = QString(argv[++i]).toInt();
+        } else if (std::strcmp(arg, "--max-packet") == 0 && hasValue) {
+            options.l2cap.maxPacketSize = QString(argv[++i]).toInt();
+        } else if (std::strcmp(arg, "--status-file") == 0 && hasValue) {
+            options.statusFile = QString(argv[++i]);
+        } else if (std::strcmp(arg, "--metrics-socket") == 0 && hasValue) {
+            options.metricsSocket = QString(argv[++i]);
+        } else if (arg[0] != '-' && options.airpodsMac.isEmpty()) {
+            options.airpodsMac = QString(arg);
+        } else {
+            return false;
+        }
+    }
+    return !options.airpodsMac.isEmpty();
+}
+
 int main(int argc, char *argv[]) {
     QCoreApplication app(argc, argv);
 
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <AirPods_MAC_Address>" << std::endl;
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [options] <AirPods_MAC_Address>" << std::endl;
         std::cerr << "Example: " << argv[0] << " 34:0E:22:49:C4:73" << std::endl;
+        std::cerr << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --transport qt|l2cap    Connection backend (default: qt)" << std::endl;
+        std::cerr << "  --rcvbuf BYTES          l2cap: socket receive buffer size" << std::endl;
+        std::cerr << "  --sndbuf BYTES          l2cap: socket send buffer size" << std::endl;
+        std::cerr << "  --connect-timeout MS    l2cap: give up on a connect attempt after MS (default: 10000)" << std::endl;
+        std::cerr << "  --batch N               l2cap: datagrams read per system call (default: 16)" << std::endl;
+        std::cerr << "  --max-packet BYTES      l2cap: largest datagram accepted, larger ones are dropped (default: 1024)" << std::endl;
+        std::cerr << "  --status-file PATH      Status page location (default: $XDG_RUNTIME_DIR/airpods-handoff.status)" << std::endl;
+        std::cerr << "  --metrics-socket PATH   Serve Prometheus metrics on a Unix socket" << std::endl;
         return 1;
     }
 
-    QString airpodsMac = QString(argv[1]);
-
     std::cout << "=== AirPods Seamless Handoff ===" << std::endl;
-    std::cout << "[" << getTimestamp().toStdString() << "] [Main] AirPods MAC: " << airpodsMac.toStdString() << std::endl;
+    std::cout << "[" << getTimestamp().toStdString() << "] [Main] AirPods MAC: " << options.airpodsMac.toStdString() << std::endl;
+
+    SystemClock metricsClock;
+    MetricsServer metrics(metricsClock);
+    if (!options.metricsSocket.isEmpty()) {
+        if (metrics.listen(options.metricsSocket)) {
+            std::cout << "[" << getTimestamp().toStdString() << "] [Main] Metrics socket: " << options.metricsSocket.toStdString() << std::endl;
+        } else {
+            std::cerr << "[" << getTimestamp().toStdString() << "] [Main] Failed to listen on " << options.metricsSocket.toStdString()
+                      << ": " << metrics.errorString().toStdString() << std::endl;
+        }
+    }
 
-    AirPodsHandoff handoff(airpodsMac);
+    AirPodsHandoff handoff(options);
 
     return app.exec();
 }
@@ -1,7 +1,8 @@
 #include "mediacontroller.h"
+#include "metrics/metrics.h"
 
-MediaController::MediaController(const QString &deviceMac, QObject *parent)
-    : QObject(parent), deviceMac(deviceMac)
+MediaController::MediaController(const QString &deviceMac, Clock &clock, QObject *parent)
+    : QObject(parent), clock(clock), deviceMac(deviceMac)
 {
     cardName = PulseAudio::getCardForDevice(deviceMac);
     sinkName = PulseAudio::getSinkForDevice(deviceMac);
@@ -33,17 +34,20 @@ void MediaController::reclaimAudioStream()
         std::cout << "[" << getTimestamp().toStdString() << "] [Media] Sink suspended" << std::endl;
     } else {
         std::cerr << "[" << getTimestamp().toStdString() << "] [Media] Failed to suspend, trying profile cycle" << std::endl;
+        Metrics::registry().suspendFailures.inc();
         cycleProfiles();
         return;
     }
 
-    QThread::msleep(200);
+    clock.sleepMs(200);
 
     // Resume the sink (sends AVDTP START)
     if (PulseAudio::suspendSink(sinkName, false)) {
         std::cout << "[" << getTimestamp().toStdString() << "] [Media] Sink resumed - handoff complete" << std::endl;
+        Metrics::registry().reclaimsSuspend.inc();
     } else {
         std::cerr << "[" << getTimestamp().toStdString() << "] [Media] Failed to resume, trying profile cycle" << std::endl;
+        Metrics::registry().resumeFailures.inc();
         cycleProfiles();
     }
 }
@@ -52,20 +56,27 @@ void MediaController::cycleProfiles()
 {
     if (cardName.isEmpty()) {
         std::cerr << "[" << getTimestamp().toStdString() << "] [Media] No card name, cannot cycle profiles" << std::endl;
+        Metrics::registry().profileCycleFailures.inc();
         return;
     }
 
     std::cout << "[" << getTimestamp().toStdString() << "] [Media] Cycling profiles: HFP -> A2DP" << std::endl;
 
     // Switch to HFP
-    PulseAudio::setProfile(cardName, "handsfree_head_unit");
+    bool switched = PulseAudio::setProfile(cardName, "handsfree_head_unit");
     std::cout << "[" << getTimestamp().toStdString() << "] [Media] Switched to HFP" << std::endl;
 
-    QThread::msleep(200);
+    clock.sleepMs(200);
 
     // Switch to A2DP
-    PulseAudio::setProfile(cardName, "a2dp_sink");
+    switched = PulseAudio::setProfile(cardName, "a2dp_sink") && switched;
     std::cout << "[" << getTimestamp().toStdString() << "] [Media] Switched to A2DP - handoff complete" << std::endl;
+
+    if (switched) {
+        Metrics::registry().reclaimsProfileCycle.inc();
+    } else {
+        Metrics::registry().profileCycleFailures.inc();
+    }
 }
 
 void MediaController::pauseAllMedia()
@@ -6,12 +6,12 @@
 #include <QDBusConnectionInterface>
 #include <QDBusInterface>
 #include <QDBusReply>
-#include <QThread>
 #include <QStringList>
 #include <QVariantMap>
 #include <QDateTime>
 #include <iostream>
 #include "pulseaudio.h"
+#include "clock/clock.h"
 
 extern QString getTimestamp();
 
@@ -19,7 +19,7 @@ class MediaController : public QObject {
     Q_OBJECT
 
 public:
-    explicit MediaController(const QString &deviceMac, QObject *parent = nullptr);
+    MediaController(const QString &deviceMac, Clock &clock, QObject *parent = nullptr);
 
     // Cycle profiles to force audio stream reclaim (fallback method)
     void cycleProfiles();
@@ -43,6 +43,7 @@ private slots:
     void onPropertiesChanged(const QString &interface, const QVariantMap &changed, const QStringList &invalidated);
 
 private:
+    Clock &clock;
     QString deviceMac;
     QString cardName;
     QString sinkName;
@@ -4,11 +4,13 @@
 #include <QString>
 #include <QProcess>
 #include <QRegularExpression>
+#include "metrics/metrics.h"
 
 class PulseAudio {
 public:
     static bool setProfile(const QString &cardName, const QString &profileName) {
         QProcess process;
+        Metrics::registry().processSpawns.inc();
         process.start("pactl", QStringList() << "set-card-profile" << cardName << profileName);
         process.waitForFinished();
         return process.exitCode() == 0;
@@ -16,6 +18,7 @@ public:
 
     static QString getCardForDevice(const QString &macAddress) {
         QProcess process;
+        Metrics::registry().processSpawns.inc();
         process.start("pactl", QStringList() << "list" << "cards" << "short");
         process.waitForFinished();
 
@@ -35,6 +38,7 @@ public:
 
     static QString getSinkForDevice(const QString &macAddress) {
         QProcess process;
+        Metrics::registry().processSpawns.inc();
         process.start("pactl", QStringList() << "list" << "sinks" << "short");
         process.waitForFinished();
 
@@ -56,6 +60,7 @@ public:
 
     static bool suspendSink(const QString &sinkName, bool suspend) {
         QProcess process;
+        Metrics::registry().processSpawns.inc();
         process.start("pactl", QStringList() << "suspend-sink" << sinkName << (suspend ? "1" : "0"));
         process.waitForFinished();
         return process.exitCode() == 0;
@@ -63,6 +68,7 @@ public:
 
     static QString getSinkIndex(const QString &sinkName) {
         QProcess process;
+        Metrics::registry().processSpawns.inc();
         process.start("pactl", QStringList() << "list" << "sinks" << "short");
         process.waitForFinished();
 
@@ -88,6 +94,7 @@ public:
         }
 
         QProcess process;
+        Metrics::registry().processSpawns.inc();
         process.start("pactl", QStringList() << "list" << "sink-inputs");
         process.waitForFinished();
 
@@ -0,0 +1,130 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+
+namespace Metrics {
+
+Histogram::Histogram(std::initializer_list<int64_t> boundsUs)
+    : boundsUs(boundsUs), buckets(new std::atomic<uint64_t>[boundsUs.size() + 1])
+{
+    for (size_t i = 0; i <= this->boundsUs.size(); i++) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observeUs(int64_t us)
+{
+    size_t i = 0;
+    while (i < boundsUs.size() && us > boundsUs[i]) {
+        i++;
+    }
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(us, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::count() const
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i <= boundsUs.size(); i++) {
+        total += bucket(i);
+    }
+    return total;
+}
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+namespace {
+    void appendf(std::string &out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    void appendf(std::string &out, const char *format, ...)
+    {
+        char line[256];
+        va_list args;
+        va_start(args, format);
+        int length = std::vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+        if (length > 0) {
+            out.append(line, std::min<size_t>(length, sizeof(line) - 1));
+        }
+    }
+
+    // OpenMetrics names the counter family without the _total suffix
+    void counterHeader(std::string &out, bool openMetrics, const char *name, const char *help)
+    {
+        appendf(out, "# HELP %s%s %s\n", name, openMetrics ? "" : "_total", help);
+        appendf(out, "# TYPE %s%s counter\n", name, openMetrics ? "" : "_total");
+    }
+
+    void counterSample(std::string &out, const char *name, const char *labels, uint64_t value)
+    {
+        appendf(out, "%s_total%s %" PRIu64 "\n", name, labels, value);
+    }
+
+    void counter(std::string &out, bool openMetrics, const char *name, const char *help, const Counter &value)
+    {
+        counterHeader(out, openMetrics, name, help);
+        counterSample(out, name, "", value.get());
+    }
+
+    void histogram(std::string &out, const char *name, const char *help, const Histogram &value)
+    {
+        appendf(out, "# HELP %s %s\n", name, help);
+        appendf(out, "# TYPE %s histogram\n", name);
+
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < value.bounds().size(); i++) {
+            cumulative += value.bucket(i);
+            appendf(out, "%s_bucket{le=\"%g\"} %" PRIu64 "\n", name, value.bounds()[i] / 1e6, cumulative);
+        }
+        cumulative += value.bucket(value.bounds().size());
+
+        // Buckets and count are read separately, keep them consistent for the scraper
+        appendf(out, "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", name, cumulative);
+        appendf(out, "%s_sum %.6f\n", name, value.sumUs() / 1e6);
+        appendf(out, "%s_count %" PRIu64 "\n", name, cumulative);
+    }
+}
+
+std::string Registry::render(bool openMetrics) const
+{
+    std::string out;
+    out.reserve(4096);
+
+    counterHeader(out, openMetrics, "airpods_handoff_audio_source_notifications", "AUDIO_SOURCE notifications received, by type.");
+    counterSample(out, "airpods_handoff_audio_source_notifications", "{type=\"none\"}", audioSourceNone.get());
+    counterSample(out, "airpods_handoff_audio_source_notifications", "{type=\"call\"}", audioSourceCall.get());
+    counterSample(out, "airpods_handoff_audio_source_notifications", "{type=\"media\"}", audioSourceMedia.get());
+
+    counter(out, openMetrics, "airpods_handoff_claims_sent", "OWNS_CONNECTION claims sent to the AirPods.", claimsSent);
+
+    counterHeader(out, openMetrics, "airpods_handoff_reclaims", "Audio stream reclaims, by method.");
+    counterSample(out, "airpods_handoff_reclaims", "{method=\"suspend\"}", reclaimsSuspend.get());
+    counterSample(out, "airpods_handoff_reclaims", "{method=\"profile_cycle\"}", reclaimsProfileCycle.get());
+
+    counterHeader(out, openMetrics, "airpods_handoff_failures", "Failed operations, by kind.");
+    counterSample(out, "airpods_handoff_failures", "{kind=\"claim\"}", claimFailures.get());
+    counterSample(out, "airpods_handoff_failures", "{kind=\"suspend\"}", suspendFailures.get());
+    counterSample(out, "airpods_handoff_failures", "{kind=\"resume\"}", resumeFailures.get());
+    counterSample(out, "airpods_handoff_failures", "{kind=\"profile_cycle\"}", profileCycleFailures.get());
+    counterSample(out, "airpods_handoff_failures", "{kind=\"connect\"}", connectFailures.get());
+
+    counter(out, openMetrics, "airpods_handoff_reconnect_attempts", "Reconnection attempts to the AirPods.", reconnectAttempts);
+    counter(out, openMetrics, "airpods_handoff_process_spawns", "External processes (pactl) started.", processSpawns);
+
+    histogram(out, "airpods_handoff_handoff_duration_seconds", "Time from a handoff decision until the audio stream was reclaimed.", handoffLatency);
+    histogram(out, "airpods_handoff_reconnect_duration_seconds", "Time from losing the connection until it was re-established.", reconnectLatency);
+
+    if (openMetrics) {
+        out.append("# EOF\n");
+    }
+    return out;
+}
+
+}
@@ -0,0 +1,76 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Process-wide counters and histograms for the metrics endpoint.
+//
+// Updates are single relaxed atomic adds so they can sit on the packet path;
+// rendering reads each value independently, so a scrape is not an atomic
+// snapshot across metrics.
+namespace Metrics {
+    class Counter {
+    public:
+        void inc(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+        uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> value{0};
+    };
+
+    class Histogram {
+    public:
+        // Upper bucket bounds in microseconds, ascending; +Inf is implied
+        Histogram(std::initializer_list<int64_t> boundsUs);
+
+        void observeUs(int64_t us);
+
+        const std::vector<int64_t> &bounds() const { return boundsUs; }
+        uint64_t bucket(size_t i) const { return buckets[i].load(std::memory_order_relaxed); }  // Not cumulative
+        uint64_t count() const;  // Sum of the buckets, there is no separate counter to drift from them
+        int64_t sumUs() const { return sum.load(std::memory_order_relaxed); }
+
+    private:
+        std::vector<int64_t> boundsUs;
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;  // bounds + 1 for +Inf
+        std::atomic<int64_t> sum{0};
+    };
+
+    struct Registry {
+        // AUDIO_SOURCE notifications by type
+        Counter audioSourceNone;
+        Counter audioSourceCall;
+        Counter audioSourceMedia;
+
+        Counter claimsSent;
+
+        // Reclaims by method
+        Counter reclaimsSuspend;
+        Counter reclaimsProfileCycle;
+
+        // Failures by kind
+        Counter claimFailures;
+        Counter suspendFailures;
+        Counter resumeFailures;
+        Counter profileCycleFailures;
+        Counter connectFailures;
+
+        Counter reconnectAttempts;
+        Counter processSpawns;  // pactl invocations
+
+        Histogram handoffLatency{50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+        Histogram reconnectLatency{1000000, 2500000, 5000000, 10000000, 30000000, 60000000, 120000000, 300000000, 600000000};
+
+        // Prometheus text exposition format 0.0.4, or OpenMetrics 1.0 when asked
+        std::string render(bool openMetrics = false) const;
+    };
+
+    Registry &registry();
+}
+
+#endif // METRICS_H
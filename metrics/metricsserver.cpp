@@ -0,0 +1,238 @@
+#include "metricsserver.h"
+
+#include <QSocketNotifier>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "metrics.h"
+
+extern QString getTimestamp();
+
+namespace {
+    constexpr int MAX_REQUEST_SIZE = 8192;
+    constexpr int MAX_CLIENTS = 16;
+    constexpr int ACCEPT_BACKOFF_MS = 1000;
+
+    void releaseNotifier(QSocketNotifier *notifier) {
+        // We may be inside its activated() signal
+        if (notifier) {
+            notifier->setEnabled(false);
+            notifier->deleteLater();
+        }
+    }
+}
+
+MetricsServer::MetricsServer(Clock &clock, QObject *parent)
+    : QObject(parent), clock(clock)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    clock.cancelTimer(acceptBackoffTimer);
+    for (auto it = clients.begin(); it != clients.end(); ++it) {
+        clock.cancelTimer(it->deadline);
+        ::close(it.key());
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        ::unlink(socketPath.toLocal8Bit().constData());
+    }
+}
+
+bool MetricsServer::listen(const QString &path)
+{
+    QByteArray encoded = path.toLocal8Bit();
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (encoded.size() >= static_cast<int>(sizeof(address.sun_path))) {
+        error = "socket path too long";
+        return false;
+    }
+    std::memcpy(address.sun_path, encoded.constData(), encoded.size());
+
+    // Remove a socket left behind by a previous run, but never anything else
+    struct stat existing;
+    if (::lstat(encoded.constData(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            error = "path exists and is not a socket";
+            return false;
+        }
+        if (::unlink(encoded.constData()) != 0) {
+            error = QString::fromLocal8Bit(std::strerror(errno));
+            return false;
+        }
+    } else if (errno != ENOENT) {
+        error = QString::fromLocal8Bit(std::strerror(errno));
+        return false;
+    }
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        error = QString::fromLocal8Bit(std::strerror(errno));
+        return false;
+    }
+
+    if (::bind(listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(listenFd, MAX_CLIENTS) != 0) {
+        error = QString::fromLocal8Bit(std::strerror(errno));
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    socketPath = path;
+    listenNotifier = new QSocketNotifier(listenFd, QSocketNotifier::Read, this);
+    connect(listenNotifier, &QSocketNotifier::activated, this, &MetricsServer::onNewConnection);
+    return true;
+}
+
+void MetricsServer::onNewConnection()
+{
+    for (;;) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;  // That connection is off the queue, try the next one
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;  // Nothing left to accept
+            }
+
+            // Out of fds or memory: the connection stays queued and the
+            // level-triggered notifier would fire again at once, so back off
+            // instead of spinning the event loop
+            std::cerr << "[" << getTimestamp().toStdString() << "] [Metrics] accept: " << std::strerror(errno)
+                      << ", pausing for " << ACCEPT_BACKOFF_MS << " ms" << std::endl;
+            listenNotifier->setEnabled(false);
+            acceptBackoffTimer = clock.startTimer(ACCEPT_BACKOFF_MS, [this]() {
+                acceptBackoffTimer = 0;
+                listenNotifier->setEnabled(true);
+            });
+            return;
+        }
+
+        if (clients.size() >= MAX_CLIENTS) {
+            ::close(fd);
+            continue;
+        }
+
+        QSocketNotifier *notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this, fd]() { onClientReadable(fd); });
+        Clock::TimerId deadline = clock.startTimer(CLIENT_TIMEOUT_MS, [this, fd]() { closeClient(fd); });
+        clients.insert(fd, Client{notifier, QByteArray(), deadline, QByteArray(), nullptr});
+    }
+}
+
+void MetricsServer::onClientReadable(int fd)
+{
+    auto it = clients.find(fd);
+    if (it == clients.end()) {
+        return;
+    }
+
+    char chunk[1024];
+    for (;;) {
+        ssize_t received = ::recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (received > 0) {
+            it->request.append(chunk, static_cast<int>(received));
+            if (it->request.size() > MAX_REQUEST_SIZE) {
+                closeClient(fd);
+                return;
+            }
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // Peer closed (or failed) before finishing its request; answer what we have
+        if (received == 0 && !it->request.isEmpty()) {
+            respond(fd);
+        } else {
+            closeClient(fd);
+        }
+        return;
+    }
+
+    // Wait for the end of the request headers
+    if (it->request.contains("\r\n\r\n") || it->request.contains("\n\n")) {
+        respond(fd);
+    }
+}
+
+void MetricsServer::respond(int fd)
+{
+    Client &client = clients[fd];
+
+    // Anything sent after the request is ignored
+    client.notifier->setEnabled(false);
+
+    bool openMetrics = client.request.contains("application/openmetrics-text");
+    std::string body = Metrics::registry().render(openMetrics);
+
+    const char *contentType = openMetrics
+        ? "application/openmetrics-text; version=1.0.0; charset=utf-8"
+        : "text/plain; version=0.0.4; charset=utf-8";
+
+    std::string header = "HTTP/1.0 200 OK\r\nContent-Type: ";
+    header += contentType;
+    header += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+
+    client.response.append(header.data(), static_cast<qsizetype>(header.size()));
+    client.response.append(body.data(), static_cast<qsizetype>(body.size()));
+    flush(fd);
+}
+
+void MetricsServer::flush(int fd)
+{
+    auto it = clients.find(fd);
+    if (it == clients.end()) {
+        return;
+    }
+
+    while (!it->response.isEmpty()) {
+        ssize_t written = ::send(fd, it->response.constData(), it->response.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written > 0) {
+            it->response.remove(0, static_cast<qsizetype>(written));
+            continue;
+        }
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Resume when the client has read some; the deadline still applies
+            if (!it->writeNotifier) {
+                it->writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+                connect(it->writeNotifier, &QSocketNotifier::activated, this, [this, fd]() { flush(fd); });
+            }
+            return;
+        }
+        break;
+    }
+
+    closeClient(fd);
+}
+
+void MetricsServer::closeClient(int fd)
+{
+    auto it = clients.find(fd);
+    if (it == clients.end()) {
+        return;
+    }
+
+    clock.cancelTimer(it->deadline);
+
+    releaseNotifier(it->notifier);
+    releaseNotifier(it->writeNotifier);
+    clients.erase(it);
+    ::close(fd);
+}
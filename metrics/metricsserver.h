@@ -0,0 +1,54 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include "clock/clock.h"
+
+class QSocketNotifier;
+
+// Serves Metrics::registry() over HTTP on a Unix domain socket, e.g.
+//   curl --unix-socket /run/user/1000/airpods-handoff.metrics http://localhost/metrics
+// Requests asking for application/openmetrics-text get OpenMetrics, everything
+// else the Prometheus text format. A client that hasn't been answered within
+// CLIENT_TIMEOUT_MS is dropped.
+class MetricsServer : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int CLIENT_TIMEOUT_MS = 5000;
+
+    explicit MetricsServer(Clock &clock, QObject *parent = nullptr);
+    ~MetricsServer() override;
+
+    bool listen(const QString &path);
+    QString errorString() const { return error; }
+
+private slots:
+    void onNewConnection();
+
+private:
+    struct Client {
+        QSocketNotifier *notifier;
+        QByteArray request;
+        Clock::TimerId deadline;
+        QByteArray response;                       // Not yet written
+        QSocketNotifier *writeNotifier = nullptr;  // Only while the socket is full
+    };
+
+    void onClientReadable(int fd);
+    void respond(int fd);
+    void flush(int fd);
+    void closeClient(int fd);
+
+    Clock &clock;
+    int listenFd = -1;
+    QString socketPath;
+    QString error;
+    QSocketNotifier *listenNotifier = nullptr;
+    Clock::TimerId acceptBackoffTimer = 0;  // Listening paused after accept() ran out of resources
+    QHash<int, Client> clients;
+};
+
+#endif // METRICSSERVER_H
@@ -63,9 +63,12 @@ in {
 
       serviceConfig = {
         Type = "simple";
-        ExecStart = "${cfg.package}/bin/airpods-handoff ${cfg.macAddress}";
+        ExecStart = "${cfg.package}/bin/airpods-handoff --status-file /run/airpods-handoff/airpods-handoff.status ${cfg.macAddress}";
         Restart = "on-failure";
         User = cfg.user;
+        # World-readable directory for the status page, read by airpods-handoff-status
+        RuntimeDirectory = "airpods-handoff";
+        RuntimeDirectoryMode = "0755";
       };
     };
   };
@@ -0,0 +1,419 @@
+// Deterministic simulation of the handoff engine in virtual time.
+//
+// A scripted world (AirPods, a phone and the Linux audio stack) drives
+// HandoffEngine through random connect/disconnect/handoff activity with fault
+// injection, checking invariants after every step. Days of activity take
+// milliseconds, and the same seed always replays the same run.
+//
+//   airpods-handoff-sim [--seed N] [--days D] [--fault-rate P] [--connect-fault-rate P] [--verbose]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include "clock/virtualclock.h"
+#include "core/handoffengine.h"
+#include "core/log.h"
+#include "core/packets.h"
+#include "metrics/metrics.h"
+
+// Engine log in virtual time, printed only with --verbose
+class VirtualTimeLog : public LogSink {
+public:
+    VirtualTimeLog(const VirtualClock &clock, bool verbose)
+        : clock(clock), startMs(clock.nowMs()), verbose(verbose)
+    {
+    }
+
+    void info(const std::string &message) override {
+        if (verbose) {
+            std::cout << "[" << timestamp() << "] " << message << std::endl;
+        }
+    }
+
+    void error(const std::string &message) override {
+        if (verbose) {
+            std::cerr << "[" << timestamp() << "] " << message << std::endl;
+        }
+    }
+
+    // day+HH:mm:ss.zzz since the start of the run
+    std::string timestamp() const {
+        int64_t elapsed = clock.nowMs() - startMs;
+        char text[32];
+        std::snprintf(text, sizeof(text), "%lld+%02d:%02d:%02d.%03d",
+                      static_cast<long long>(elapsed / 86400000),
+                      static_cast<int>(elapsed / 3600000 % 24),
+                      static_cast<int>(elapsed / 60000 % 60),
+                      static_cast<int>(elapsed / 1000 % 60),
+                      static_cast<int>(elapsed % 1000));
+        return text;
+    }
+
+private:
+    const VirtualClock &clock;
+    int64_t startMs;
+    bool verbose;
+};
+
+// Keep some connects succeeding, otherwise a run never reaches the handoff logic
+static constexpr double MAX_CONNECT_FAULT_RATE = 0.9;
+
+struct Options {
+    uint64_t seed = 1;
+    double days = 1.0;
+    double faultRate = 0.05;         // Probability that a scripted step is a link drop or silent death
+    double connectFaultRate = 0.2;   // Probability that a connect attempt fails, at most MAX_CONNECT_FAULT_RATE
+    bool verbose = false;
+};
+
+struct Stats {
+    uint64_t events = 0;
+    uint64_t connectAttempts = 0;
+    uint64_t connectFailures = 0;
+    uint64_t connects = 0;
+    uint64_t linkDrops = 0;
+    uint64_t silentDeaths = 0;
+    uint64_t watchdogReconnects = 0;
+    uint64_t claims = 0;
+    uint64_t reclaims = 0;
+    uint64_t pauses = 0;
+    int64_t maxOutageMs = 0;
+    uint64_t violations = 0;
+};
+
+class SimulatedWorld : public HandoffEngine::Transport, public HandoffEngine::AudioBackend {
+public:
+    static const Packets::Bytes LOCAL_MAC;
+    static const Packets::Bytes PHONE_MAC;
+
+    SimulatedWorld(VirtualClock &clock, const VirtualTimeLog &log, const Options &options)
+        : clock(clock), log(log), options(options), rng(options.seed)
+    {
+    }
+
+    void attach(HandoffEngine *handoff) { engine = handoff; }
+    const Stats &stats() const { return counters; }
+
+    // HandoffEngine::Transport
+    bool isConnected() const override {
+        return link == UP;
+    }
+
+    int64_t send(const Packets::Bytes &packet) override {
+        if (link != UP) {
+            return -1;
+        }
+
+        if (packet == Packets::Connection::HANDSHAKE) {
+            deliver(Packets::Connection::FEATURES_ACK, uniform(5, 50));
+        } else if (packet == Packets::Connection::REQUEST_NOTIFICATIONS) {
+            deliver(Packets::AudioSource::create(ownerMac, ownerType), uniform(5, 50));
+        } else if (packet == Packets::OwnsConnection::CLAIM) {
+            counters.claims++;
+            setOwner(LOCAL_MAC, Packets::AudioSource::MEDIA);
+        }
+        return static_cast<int64_t>(packet.size());
+    }
+
+    void connectToAirPods() override {
+        counters.connectAttempts++;
+        if (link == DOWN && downSince > 0) {
+            int64_t outage = clock.nowMs() - downSince;
+            counters.maxOutageMs = std::max(counters.maxOutageMs, outage);
+            if (outage > HandoffEngine::RECONNECT_MAX_DELAY + 1000) {
+                violation("reconnect attempt " + std::to_string(outage) + " ms after the link went down");
+            }
+        }
+
+        link = CONNECTING;
+        silent = false;
+        uint64_t attempt = ++generation;
+        bool fails = chance(options.connectFaultRate);
+
+        clock.startTimer(uniform(300, 3000), [this, attempt, fails]() {
+            if (attempt != generation || link != CONNECTING) {
+                return;
+            }
+            if (fails) {
+                counters.connectFailures++;
+                goDown();
+                engine->onConnectFailed();
+                return;
+            }
+            link = UP;
+            counters.connects++;
+            engine->onConnected();
+            if (engine->reconnectAttempts() != 0 || engine->isReconnectScheduled()) {
+                violation("reconnection state not reset after connecting");
+            }
+        });
+    }
+
+    void disconnectFromAirPods() override {
+        if (link != UP) {
+            return;
+        }
+        if (silent) {
+            silent = false;
+            counters.watchdogReconnects++;
+        }
+        uint64_t connection = generation;
+        clock.startTimer(uniform(5, 100), [this, connection]() {
+            if (connection == generation && link == UP) {
+                dropLink();
+            }
+        });
+    }
+
+    // HandoffEngine::AudioBackend
+    void reclaimAudioStream() override {
+        counters.reclaims++;
+        clock.sleepMs(200);  // Suspend, wait, resume
+    }
+
+    void pauseAllMedia() override {
+        counters.pauses++;
+        linuxPlaying = false;
+    }
+
+    bool isMediaPlaying() override {
+        return linuxPlaying;
+    }
+
+    bool hasActiveAudio() override {
+        return linuxActiveAudio;
+    }
+
+    // Scripted activity, one random step at a time
+    void scheduleNextEvent() {
+        std::exponential_distribution<double> gap(1.0 / 90000.0);  // One step every 90 s on average
+        clock.startTimer(static_cast<int64_t>(gap(rng)) + 1, [this]() {
+            step();
+            scheduleNextEvent();
+        });
+    }
+
+    void checkInvariants() {
+        // A dead link must always have a reconnection on the way
+        if (link == DOWN && !engine->isReconnectScheduled()) {
+            violation("link is down and no reconnection is scheduled");
+        }
+
+        // A connection that silently stopped delivering must be noticed
+        int64_t deadline = HandoffEngine::NOTIFICATION_TIMEOUT + HandoffEngine::KEEPALIVE_INTERVAL + 1000;
+        if (silent && clock.nowMs() - silentSince > deadline) {
+            violation("silent connection not detected after " + std::to_string(clock.nowMs() - silentSince) + " ms");
+            silent = false;
+        }
+    }
+
+    // The engine's own counters must agree with what the world saw
+    void checkMetrics(const Metrics::Registry &metrics) {
+        if (metrics.claimsSent.get() != counters.claims) {
+            violation("engine counted " + std::to_string(metrics.claimsSent.get()) + " claims, AirPods saw " +
+                      std::to_string(counters.claims));
+        }
+        if (metrics.connectFailures.get() != counters.connectFailures) {
+            violation("engine counted " + std::to_string(metrics.connectFailures.get()) + " connect failures, " +
+                      std::to_string(counters.connectFailures) + " were injected");
+        }
+        if (counters.connectAttempts > 0 && metrics.reconnectAttempts.get() != counters.connectAttempts - 1) {
+            violation("engine counted " + std::to_string(metrics.reconnectAttempts.get()) + " reconnects for " +
+                      std::to_string(counters.connectAttempts) + " connect attempts");
+        }
+    }
+
+private:
+    enum LinkState { DOWN, CONNECTING, UP };
+
+    void step() {
+        counters.events++;
+
+        if (chance(options.faultRate)) {
+            if (link == UP && chance(0.5)) {
+                counters.linkDrops++;
+                dropLink();
+            } else if (link == UP && !silent) {
+                counters.silentDeaths++;
+                silent = true;
+                silentSince = clock.nowMs();
+            }
+            return;
+        }
+
+        switch (uniform(0, 5)) {
+            case 0:  // Phone starts playing media
+                setOwner(PHONE_MAC, Packets::AudioSource::MEDIA);
+                break;
+            case 1:  // Phone call
+                setOwner(PHONE_MAC, Packets::AudioSource::CALL);
+                break;
+            case 2:  // Phone stops
+                if (ownerMac == PHONE_MAC && ownerType != Packets::AudioSource::NONE) {
+                    setOwner(PHONE_MAC, Packets::AudioSource::NONE);
+                }
+                break;
+            case 3:  // Linux starts playing (MPRIS)
+                linuxPlaying = true;
+                engine->onPlaybackStarted();
+                break;
+            case 4:  // Linux stops
+                linuxPlaying = false;
+                linuxActiveAudio = false;
+                break;
+            case 5:  // Non-MPRIS audio (Discord, games)
+                linuxActiveAudio = !linuxActiveAudio;
+                break;
+        }
+    }
+
+    void setOwner(const Packets::Bytes &mac, Packets::AudioSource::Type type) {
+        ownerMac = mac;
+        ownerType = type;
+        deliver(Packets::AudioSource::create(ownerMac, ownerType), uniform(5, 50));
+    }
+
+    void deliver(const Packets::Bytes &packet, int64_t delayMs) {
+        uint64_t connection = generation;
+        clock.startTimer(delayMs, [this, packet, connection]() {
+            if (connection != generation || link != UP || silent) {
+                return;
+            }
+
+            auto info = Packets::AudioSource::parse(packet);
+            bool expectReclaim = info.isValid && info.type == Packets::AudioSource::NONE && engine->shouldReclaimOnNone();
+
+            engine->onPacket(packet);
+
+            if (expectReclaim && link == UP && ownerMac != LOCAL_MAC) {
+                violation("another device released audio but it was not reclaimed");
+            }
+        });
+    }
+
+    void dropLink() {
+        goDown();
+        engine->onDisconnected();
+    }
+
+    void goDown() {
+        link = DOWN;
+        silent = false;
+        generation++;
+        downSince = clock.nowMs();
+    }
+
+    int64_t uniform(int64_t low, int64_t high) {
+        return std::uniform_int_distribution<int64_t>(low, high)(rng);
+    }
+
+    bool chance(double probability) {
+        return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < probability;
+    }
+
+    void violation(const std::string &what) {
+        counters.violations++;
+        std::fprintf(stderr, "[%s] VIOLATION: %s\n", log.timestamp().c_str(), what.c_str());
+    }
+
+    VirtualClock &clock;
+    const VirtualTimeLog &log;
+    Options options;
+    std::mt19937_64 rng;
+    HandoffEngine *engine = nullptr;
+    Stats counters;
+
+    LinkState link = DOWN;
+    uint64_t generation = 0;  // Bumped on every connect/drop to discard stale deliveries
+    int64_t downSince = 0;
+    bool silent = false;
+    int64_t silentSince = 0;
+
+    Packets::Bytes ownerMac = PHONE_MAC;
+    Packets::AudioSource::Type ownerType = Packets::AudioSource::NONE;
+    bool linuxPlaying = false;
+    bool linuxActiveAudio = false;
+};
+
+// Reversed, as they appear in AUDIO_SOURCE
+const Packets::Bytes SimulatedWorld::LOCAL_MAC = {0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+const Packets::Bytes SimulatedWorld::PHONE_MAC = {0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6};
+
+static bool parseOptions(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--seed") == 0 && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(arg, "--days") == 0 && hasValue) {
+            options.days = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(arg, "--fault-rate") == 0 && hasValue) {
+            options.faultRate = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(arg, "--connect-fault-rate") == 0 && hasValue) {
+            options.connectFaultRate = std::min(std::strtod(argv[++i], nullptr), MAX_CONNECT_FAULT_RATE);
+        } else if (std::strcmp(arg, "--verbose") == 0) {
+            options.verbose = true;
+        } else {
+            return false;
+        }
+    }
+    return options.days > 0 && options.faultRate >= 0 && options.faultRate <= 1 && options.connectFaultRate >= 0;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--seed N] [--days D] [--fault-rate P] [--connect-fault-rate P] [--verbose]" << std::endl;
+        return 2;
+    }
+
+    VirtualClock clock;
+    VirtualTimeLog log(clock, options.verbose);
+    int64_t startMs = clock.nowMs();
+
+    SimulatedWorld world(clock, log, options);
+    Metrics::Registry metrics;
+    HandoffEngine engine(SimulatedWorld::LOCAL_MAC, world, world, clock, log, metrics);
+    world.attach(&engine);
+
+    auto wallStart = std::chrono::steady_clock::now();
+    int64_t end = startMs + static_cast<int64_t>(options.days * 86400000.0);
+
+    engine.start();
+    world.scheduleNextEvent();
+
+    while (clock.nextDeadline() != -1 && clock.nextDeadline() <= end) {
+        clock.runNextTimer();
+        world.checkInvariants();
+    }
+    world.checkMetrics(metrics);
+
+    auto wallMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - wallStart).count();
+    const Stats &stats = world.stats();
+
+    std::printf("seed=%llu days=%.2f fault_rate=%.3f connect_fault_rate=%.3f wall_ms=%lld\n",
+                static_cast<unsigned long long>(options.seed), options.days, options.faultRate, options.connectFaultRate,
+                static_cast<long long>(wallMs));
+    std::printf("events=%llu connects=%llu connect_attempts=%llu connect_failures=%llu link_drops=%llu silent_deaths=%llu watchdog_reconnects=%llu\n",
+                static_cast<unsigned long long>(stats.events), static_cast<unsigned long long>(stats.connects),
+                static_cast<unsigned long long>(stats.connectAttempts),
+                static_cast<unsigned long long>(stats.connectFailures), static_cast<unsigned long long>(stats.linkDrops),
+                static_cast<unsigned long long>(stats.silentDeaths), static_cast<unsigned long long>(stats.watchdogReconnects));
+    std::printf("claims=%llu reclaims=%llu pauses=%llu max_outage_ms=%lld violations=%llu\n",
+                static_cast<unsigned long long>(stats.claims), static_cast<unsigned long long>(stats.reclaims),
+                static_cast<unsigned long long>(stats.pauses), static_cast<long long>(stats.maxOutageMs),
+                static_cast<unsigned long long>(stats.violations));
+
+    // A run that never got connected, or never handed off, checked nothing
+    if (options.days >= 1.0 && (stats.connects == 0 || stats.claims == 0)) {
+        std::fprintf(stderr, "Run never exercised the handoff logic (connects=%llu claims=%llu)\n",
+                     static_cast<unsigned long long>(stats.connects), static_cast<unsigned long long>(stats.claims));
+        return 1;
+    }
+
+    return stats.violations == 0 ? 0 : 1;
+}
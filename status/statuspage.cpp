@@ -0,0 +1,177 @@
+#include "statuspage.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace StatusPage {
+
+std::string defaultPath()
+{
+    // No shared /tmp fallback: a predictable path there can be pre-created by anyone
+    const char *runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && *runtimeDir) {
+        return std::string(runtimeDir) + "/airpods-handoff.status";
+    }
+    return std::string();
+}
+
+Writer::Writer(const std::string &path)
+    : path(path)
+{
+    if (path.empty()) {
+        error = "XDG_RUNTIME_DIR is not set";
+        return;
+    }
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = path + ": " + std::strerror(errno);
+        return;
+    }
+
+    // Only ever truncate a regular file we own
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != getuid()) {
+        error = path + ": not a regular file owned by this user";
+        ::close(fd);
+        return;
+    }
+    device = st.st_dev;
+    inode = st.st_ino;
+
+    if (ftruncate(fd, sizeof(Layout)) != 0) {
+        error = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return;
+    }
+
+    void *mapped = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = path + ": " + std::strerror(errno);
+        return;
+    }
+
+    // Keep the counter odd while the header is (re)initialised, so readers of a
+    // page left behind by a previous instance never see a torn header
+    page = static_cast<Layout *>(mapped);
+    uint32_t seq = page->sequence.load(std::memory_order_relaxed) | 1u;
+    page->sequence.store(seq, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    page->magic = MAGIC;
+    page->version = VERSION;
+    page->pid = static_cast<int32_t>(getpid());
+    page->size = sizeof(Layout);
+    std::memcpy(&page->data, &snapshot, sizeof(Snapshot));
+
+    page->sequence.store(seq + 1, std::memory_order_release);
+}
+
+Writer::~Writer()
+{
+    if (!page) {
+        return;
+    }
+
+    // Another instance may have taken the page over (it rewrites the pid) or
+    // replaced the file; only remove what is still ours
+    bool ours = page->pid == static_cast<int32_t>(getpid());
+    munmap(page, sizeof(Layout));
+
+    // Don't leave a page behind that still claims to be connected
+    struct stat st;
+    if (ours && ::lstat(path.c_str(), &st) == 0 && st.st_dev == device && st.st_ino == inode) {
+        ::unlink(path.c_str());
+    }
+}
+
+void Writer::publish(int64_t nowMs)
+{
+    if (!page) {
+        return;
+    }
+
+    snapshot.updatedAtMs = nowMs;
+
+    // Single writer: make the counter odd, copy, make it even again
+    uint32_t seq = page->sequence.load(std::memory_order_relaxed);
+    page->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(&page->data, &snapshot, sizeof(Snapshot));
+
+    page->sequence.store(seq + 2, std::memory_order_release);
+}
+
+Reader::Reader(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = path + ": " + std::strerror(errno);
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < static_cast<off_t>(sizeof(Layout))) {
+        error = path + ": not a status page";
+        ::close(fd);
+        return;
+    }
+
+    void *mapped = mmap(nullptr, sizeof(Layout), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = path + ": " + std::strerror(errno);
+        return;
+    }
+
+    page = static_cast<const Layout *>(mapped);
+    if (page->magic != MAGIC || page->version != VERSION || page->size != sizeof(Layout)) {
+        error = path + ": unsupported status page version";
+        munmap(const_cast<Layout *>(page), sizeof(Layout));
+        page = nullptr;
+    }
+}
+
+Reader::~Reader()
+{
+    if (page) {
+        munmap(const_cast<Layout *>(page), sizeof(Layout));
+    }
+}
+
+int32_t Reader::writerPid() const
+{
+    return page ? page->pid : 0;
+}
+
+bool Reader::read(Snapshot &out, int maxRetries) const
+{
+    if (!page) {
+        return false;
+    }
+
+    for (int attempt = 0; attempt < maxRetries; ++attempt) {
+        uint32_t before = page->sequence.load(std::memory_order_acquire);
+        if (before & 1u) {
+            continue;  // Write in progress
+        }
+
+        std::memcpy(&out, &page->data, sizeof(Snapshot));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t after = page->sequence.load(std::memory_order_relaxed);
+        if (before == after) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
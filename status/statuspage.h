@@ -0,0 +1,111 @@
+#ifndef STATUSPAGE_H
+#define STATUSPAGE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+// Shared-memory status page for status bars and widgets.
+//
+// The daemon keeps a small memory-mapped file under $XDG_RUNTIME_DIR up to
+// date. Writes are guarded by a seqlock: the sequence counter is odd while a
+// write is in progress, so readers copy the snapshot and retry if the counter
+// changed underneath them. Readers never block the daemon and the daemon never
+// has to wake anyone up.
+namespace StatusPage {
+    static constexpr uint32_t MAGIC = 0x53484150;  // "PAHS"
+    static constexpr uint32_t VERSION = 1;
+
+    enum ConnectionState : uint8_t {
+        DISCONNECTED = 0,
+        CONNECTING = 1,
+        CONNECTED = 2
+    };
+
+    // Plain data copied in and out of the page under the seqlock
+    struct Snapshot {
+        uint8_t connectionState;
+        uint8_t ownerValid;       // Set once the first AUDIO_SOURCE has been seen
+        uint8_t ownerType;        // Packets::AudioSource::Type
+        uint8_t ownerIsLocal;     // The audio owner is this machine
+        uint8_t ownerMac[6];      // Display order (as printed by bluetoothctl)
+        uint8_t reserved[6];
+        int64_t updatedAtMs;      // Wall clock of the last publish
+        int64_t lastHandoffUs;    // Duration of the last claim + reclaim, 0 if none yet
+        uint64_t audioSourceNotifications;
+        uint64_t claimsSent;
+        uint64_t handoffs;
+        uint64_t reconnectAttempts;
+        uint64_t disconnects;
+    };
+
+    struct Layout {
+        uint32_t magic;
+        uint32_t version;
+        int32_t pid;
+        uint32_t size;            // sizeof(Layout) of the writer
+        std::atomic<uint32_t> sequence;
+        uint32_t reserved;
+        Snapshot data;
+    };
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "seqlock needs a lock-free counter");
+
+    // Where the NixOS system service (and any daemon started with
+    // --status-file) publishes the page; readers look here second
+    static constexpr const char *SYSTEM_PATH = "/run/airpods-handoff/airpods-handoff.status";
+
+    // $XDG_RUNTIME_DIR/airpods-handoff.status, or empty when XDG_RUNTIME_DIR is unset
+    std::string defaultPath();
+
+    class Writer {
+    public:
+        explicit Writer(const std::string &path = defaultPath());
+        ~Writer();
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        bool isOpen() const { return page != nullptr; }
+        const std::string &filePath() const { return path; }
+        const std::string &errorString() const { return error; }
+
+        // Local copy of the state; modify it and call publish() to make it visible
+        Snapshot &current() { return snapshot; }
+
+        void publish(int64_t nowMs);
+
+    private:
+        std::string path;
+        std::string error;
+        Layout *page = nullptr;
+        Snapshot snapshot{};
+        dev_t device = 0;   // Identity of the mapped file, so the destructor
+        ino_t inode = 0;    // never removes a page another instance replaced
+    };
+
+    class Reader {
+    public:
+        explicit Reader(const std::string &path = defaultPath());
+        ~Reader();
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        bool isOpen() const { return page != nullptr; }
+        const std::string &errorString() const { return error; }
+
+        // PID of the daemon that owns the page
+        int32_t writerPid() const;
+
+        // Copy a consistent snapshot; returns false if the writer kept racing us
+        bool read(Snapshot &out, int maxRetries = 1000) const;
+
+    private:
+        const Layout *page = nullptr;
+        std::string error;
+    };
+}
+
+#endif // STATUSPAGE_H
@@ -0,0 +1,240 @@
+// HandoffEngine decisions against fake AirPods and audio stack in virtual time
+
+#include <string>
+#include <vector>
+#include "check.h"
+#include "clock/virtualclock.h"
+#include "core/handoffengine.h"
+#include "core/log.h"
+#include "core/packets.h"
+#include "metrics/metrics.h"
+
+using Packets::Bytes;
+
+static const Bytes LOCAL_MAC = {0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0x01};
+static const Bytes PHONE_MAC = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+
+class QuietLog : public LogSink {
+public:
+    void info(const std::string &) override {}
+    void error(const std::string &) override {}
+};
+
+// Records what the engine asks for; the test decides how the link responds
+class FakeDevice : public HandoffEngine::Transport, public HandoffEngine::AudioBackend {
+public:
+    bool isConnected() const override { return connected; }
+
+    int64_t send(const Bytes &packet) override {
+        if (!connected || failSends) {
+            return -1;
+        }
+        sent.push_back(packet);
+        return static_cast<int64_t>(packet.size());
+    }
+
+    void connectToAirPods() override { connectAttempts++; }
+
+    void disconnectFromAirPods() override {
+        disconnects++;
+        if (connected) {
+            connected = false;
+            engine->onDisconnected();
+        }
+    }
+
+    void reclaimAudioStream() override { reclaims++; }
+    void pauseAllMedia() override { pauses++; }
+    bool isMediaPlaying() override { return mediaPlaying; }
+    bool hasActiveAudio() override { return activeAudio; }
+
+    int claimsSent() const {
+        int claims = 0;
+        for (const Bytes &packet : sent) {
+            claims += packet == Packets::OwnsConnection::CLAIM;
+        }
+        return claims;
+    }
+
+    HandoffEngine *engine = nullptr;
+    bool connected = false;
+    bool failSends = false;
+    bool mediaPlaying = false;
+    bool activeAudio = false;
+    std::vector<Bytes> sent;
+    int connectAttempts = 0;
+    int disconnects = 0;
+    int reclaims = 0;
+    int pauses = 0;
+};
+
+struct Fixture {
+    Fixture() : engine(LOCAL_MAC, device, device, clock, log, metrics) {
+        device.engine = &engine;
+    }
+
+    void connect() {
+        device.connected = true;
+        engine.onConnected();
+        engine.onPacket(Packets::Connection::FEATURES_ACK);
+    }
+
+    VirtualClock clock;
+    QuietLog log;
+    Metrics::Registry metrics;
+    FakeDevice device;
+    HandoffEngine engine;
+};
+
+static void testTakeThenReleaseIsReclaimed() {
+    Fixture f;
+    f.engine.start();
+    f.connect();
+
+    // We own audio, then the phone takes it
+    f.engine.onPacket(Packets::AudioSource::create(LOCAL_MAC, Packets::AudioSource::MEDIA));
+    CHECK(f.device.pauses == 0);
+    f.engine.onPacket(Packets::AudioSource::create(PHONE_MAC, Packets::AudioSource::MEDIA));
+    CHECK(f.device.pauses == 1);
+    CHECK(f.engine.shouldReclaimOnNone());
+    CHECK(f.device.reclaims == 0);
+    CHECK(f.device.claimsSent() == 0);
+
+    // The phone lets go: claim and take the stream back, once
+    f.engine.onPacket(Packets::AudioSource::create(PHONE_MAC, Packets::AudioSource::NONE));
+    CHECK(f.device.claimsSent() == 1);
+    CHECK(f.device.reclaims == 1);
+    CHECK(!f.engine.shouldReclaimOnNone());
+
+    f.engine.onPacket(Packets::AudioSource::create(PHONE_MAC, Packets::AudioSource::NONE));
+    CHECK(f.device.claimsSent() == 1);
+    CHECK(f.device.reclaims == 1);
+
+    CHECK(f.metrics.audioSourceMedia.get() == 2);
+    CHECK(f.metrics.audioSourceNone.get() == 2);
+    CHECK(f.metrics.audioSourceCall.get() == 0);
+    CHECK(f.metrics.claimsSent.get() == 1);
+    CHECK(f.metrics.claimFailures.get() == 0);
+    CHECK(f.metrics.handoffLatency.count() == 1);
+}
+
+static void testReleaseWithoutTakeIsIgnored() {
+    Fixture f;
+    f.engine.start();
+    f.connect();
+
+    // The phone plays while Linux is idle, nothing to give back afterwards
+    f.engine.onPacket(Packets::AudioSource::create(PHONE_MAC, Packets::AudioSource::MEDIA));
+    CHECK(!f.engine.shouldReclaimOnNone());
+    f.engine.onPacket(Packets::AudioSource::create(PHONE_MAC, Packets::AudioSource::NONE));
+    CHECK(f.device.claimsSent() == 0);
+    CHECK(f.device.reclaims == 0);
+    CHECK(f.metrics.claimsSent.get() == 0);
+    CHECK(f.metrics.handoffLatency.count() == 0);
+}
+
+static void testFailedClaimIsCounted() {
+    Fixture f;
+    f.engine.start();
+    f.connect();
+    f.engine.onPacket(Packets::AudioSource::create(PHONE_MAC, Packets::AudioSource::MEDIA));
+
+    // Linux starts playing while the phone owns audio, but the claim can't be sent
+    f.device.failSends = true;
+    f.engine.onPlaybackStarted();
+    CHECK(f.metrics.claimsSent.get() == 0);
+    CHECK(f.metrics.claimFailures.get() == 1);
+    CHECK(f.device.reclaims == 1);
+    CHECK(f.metrics.handoffLatency.count() == 1);
+
+    // A fresh engine starts from zero: counters are per registry
+    Fixture other;
+    CHECK(other.metrics.audioSourceMedia.get() == 0);
+    CHECK(f.metrics.audioSourceMedia.get() == 1);
+}
+
+static void testWatchdogForcesReconnect() {
+    Fixture f;
+    f.engine.start();
+    f.connect();
+
+    // Notifications keep the connection alive
+    f.clock.advance(HandoffEngine::NOTIFICATION_TIMEOUT - HandoffEngine::KEEPALIVE_INTERVAL);
+    f.engine.onPacket(Packets::AudioSource::create(PHONE_MAC, Packets::AudioSource::NONE));
+    f.clock.advance(HandoffEngine::NOTIFICATION_TIMEOUT);
+    CHECK(f.device.disconnects == 0);
+
+    // Silence past the timeout is caught by the next keepalive check
+    f.clock.advance(2 * HandoffEngine::KEEPALIVE_INTERVAL);
+    CHECK(f.device.disconnects == 1);
+    CHECK(!f.device.connected);
+    CHECK(f.engine.lastNotificationTime() == 0);
+    CHECK(f.device.connectAttempts == 2);  // Reconnected after the base delay
+    CHECK(f.metrics.reconnectAttempts.get() == 1);
+
+    // Disconnected links are not checked again
+    f.clock.advance(HandoffEngine::NOTIFICATION_TIMEOUT + HandoffEngine::KEEPALIVE_INTERVAL);
+    CHECK(f.device.disconnects == 1);
+}
+
+static void testWatchdogCoversHandshake() {
+    Fixture f;
+    f.engine.start();
+
+    // Connected, but FEATURES_ACK never arrives
+    f.device.connected = true;
+    f.engine.onConnected();
+    CHECK(f.engine.lastNotificationTime() == f.clock.nowMs());
+
+    f.clock.advance(HandoffEngine::NOTIFICATION_TIMEOUT);
+    CHECK(f.device.disconnects == 0);
+    f.clock.advance(HandoffEngine::KEEPALIVE_INTERVAL);
+    CHECK(f.device.disconnects == 1);
+    CHECK(!f.device.connected);
+}
+
+static void testReconnectBackoff() {
+    const int expected[] = {2000, 4000, 8000, 16000, 30000, 30000, 30000};
+    for (int attempt = 0; attempt < 7; attempt++) {
+        CHECK(HandoffEngine::reconnectDelay(attempt) == expected[attempt]);
+    }
+    CHECK(HandoffEngine::reconnectDelay(1000) == HandoffEngine::RECONNECT_MAX_DELAY);
+
+    // The engine waits exactly that long between failed attempts
+    Fixture f;
+    f.engine.start();
+    CHECK(f.device.connectAttempts == 1);
+    for (int attempt = 0; attempt < 7; attempt++) {
+        f.engine.onConnectFailed();
+        CHECK(f.engine.reconnectAttempts() == attempt + 1);
+
+        f.clock.advance(expected[attempt] - 1);
+        CHECK(f.device.connectAttempts == attempt + 1);
+        f.clock.advance(1);
+        CHECK(f.device.connectAttempts == attempt + 2);
+    }
+
+    CHECK(f.metrics.connectFailures.get() == 7);
+    CHECK(f.metrics.reconnectAttempts.get() == 7);
+
+    // A successful connect starts the sequence over
+    f.connect();
+    CHECK(f.engine.reconnectAttempts() == 0);
+    f.device.disconnectFromAirPods();
+    int attempts = f.device.connectAttempts;
+    f.clock.advance(HandoffEngine::RECONNECT_BASE_DELAY);
+    CHECK(f.device.connectAttempts == attempts + 1);
+    CHECK(f.metrics.reconnectAttempts.get() == 8);
+    CHECK(f.metrics.reconnectLatency.count() == 0);  // Never reconnected successfully after the drop
+}
+
+int main() {
+    testTakeThenReleaseIsReclaimed();
+    testReleaseWithoutTakeIsIgnored();
+    testFailedClaimIsCounted();
+    testWatchdogForcesReconnect();
+    testWatchdogCoversHandshake();
+    testReconnectBackoff();
+
+    return checkResult();
+}
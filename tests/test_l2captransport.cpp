@@ -0,0 +1,152 @@
+// L2capTransport receive path against a socketpair() standing in for the AirPods
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "check.h"
+#include "clock/systemclock.h"
+#include "transport/l2captransport.h"
+
+QString getTimestamp() {
+    return QDateTime::currentDateTime().toString("HH:mm:ss.zzz");
+}
+
+static bool sendSequence(int fd, quint32 sequence) {
+    char packet[32] = {};
+    std::memcpy(packet, &sequence, sizeof(sequence));
+    return ::send(fd, packet, sizeof(packet), MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(packet));
+}
+
+static quint32 sequenceOf(const QByteArray &packet) {
+    quint32 sequence = 0;
+    std::memcpy(&sequence, packet.constData(), sizeof(sequence));
+    return sequence;
+}
+
+static void testBurstIsDrainedInOneWakeup() {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == 0);
+
+    SystemClock clock;
+    L2capTransport::Options options;
+    options.batchSize = 4;
+    L2capTransport transport(clock, options);
+
+    std::vector<quint32> received;
+    int disconnects = 0;
+    QObject::connect(&transport, &Transport::packetReceived, [&received](const QByteArray &packet) {
+        received.push_back(sequenceOf(packet));
+    });
+    QObject::connect(&transport, &Transport::disconnected, [&disconnects]() { disconnects++; });
+
+    CHECK(transport.adoptDescriptor(fds[0]));
+    CHECK(transport.isConnected());
+
+    // Well over batchSize, all queued before the transport gets a wakeup
+    const quint32 burst = 10 * options.batchSize + 3;
+    for (quint32 i = 0; i < burst; i++) {
+        CHECK(sendSequence(fds[1], i));
+    }
+
+    // The first event loop pass that delivers anything must deliver everything
+    for (int pass = 0; pass < 100 && received.empty(); pass++) {
+        QCoreApplication::processEvents();
+    }
+    CHECK(received.size() == burst);
+    for (quint32 i = 0; i < received.size(); i++) {
+        CHECK(received[i] == i);
+    }
+
+    // Peer close is reported once, however often the loop spins afterwards
+    ::close(fds[1]);
+    for (int pass = 0; pass < 100 && disconnects == 0; pass++) {
+        QCoreApplication::processEvents();
+    }
+    for (int pass = 0; pass < 10; pass++) {
+        QCoreApplication::processEvents();
+    }
+    CHECK(disconnects == 1);
+    CHECK(!transport.isConnected());
+
+    // Disconnecting an already closed transport stays quiet
+    transport.disconnectFromDevice();
+    CHECK(disconnects == 1);
+}
+
+static void testOversizedDatagramIsDropped() {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == 0);
+
+    SystemClock clock;
+    L2capTransport::Options options;
+    options.maxPacketSize = 64;
+    L2capTransport transport(clock, options);
+
+    std::vector<QByteArray> received;
+    QObject::connect(&transport, &Transport::packetReceived, [&received](const QByteArray &packet) {
+        received.push_back(packet);
+    });
+    CHECK(transport.adoptDescriptor(fds[0]));
+
+    char oversized[200] = {};
+    CHECK(sendSequence(fds[1], 1));
+    CHECK(::send(fds[1], oversized, sizeof(oversized), MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(oversized)));
+    CHECK(sendSequence(fds[1], 2));
+
+    for (int pass = 0; pass < 100 && received.size() < 2; pass++) {
+        QCoreApplication::processEvents();
+    }
+
+    // Only the whole datagrams get through, and the link stays up
+    CHECK(received.size() == 2);
+    CHECK(received.size() == 2 && sequenceOf(received[0]) == 1 && sequenceOf(received[1]) == 2);
+    CHECK(received.size() == 2 && received[0].size() == 32);
+    CHECK(transport.isConnected());
+
+    transport.disconnectFromDevice();
+    ::close(fds[1]);
+}
+
+static void testAdoptFailureClosesDescriptor() {
+    SystemClock clock;
+    L2capTransport::Options options;
+    options.receiveBufferSize = 65536;  // setsockopt() fails on anything but a socket
+    L2capTransport transport(clock, options);
+
+    int connects = 0;
+    QObject::connect(&transport, &Transport::connected, [&connects]() { connects++; });
+
+    // A live fd that can't be set up is closed, not handed back
+    int pipeFds[2];
+    CHECK(pipe(pipeFds) == 0);
+    CHECK(!transport.adoptDescriptor(pipeFds[0]));
+    CHECK(errno == ENOTSOCK);
+    CHECK(fcntl(pipeFds[0], F_GETFD) < 0 && errno == EBADF);
+    CHECK(connects == 0);
+    CHECK(!transport.isConnected());
+    ::close(pipeFds[1]);
+
+    // A good fd still works afterwards, and is closed by the transport
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == 0);
+    CHECK(transport.adoptDescriptor(fds[0]));
+    CHECK(connects == 1);
+    transport.disconnectFromDevice();
+    CHECK(fcntl(fds[0], F_GETFD) < 0 && errno == EBADF);
+    ::close(fds[1]);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    testBurstIsDrainedInOneWakeup();
+    testOversizedDatagramIsDropped();
+    testAdoptFailureClosesDescriptor();
+
+    return checkResult();
+}
@@ -0,0 +1,104 @@
+// Prometheus and OpenMetrics exposition of a local registry
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include "check.h"
+#include "metrics/metrics.h"
+
+static bool hasLine(const std::string &text, const std::string &line) {
+    return ("\n" + text).find("\n" + line + "\n") != std::string::npos;
+}
+
+static size_t occurrences(const std::string &text, const std::string &needle) {
+    size_t count = 0;
+    for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) {
+        count++;
+    }
+    return count;
+}
+
+// Every _bucket sample of a family, in order, must never decrease
+static bool bucketsAreCumulative(const std::string &text, const std::string &family) {
+    std::string prefix = family + "_bucket{le=\"";
+    uint64_t previous = 0;
+    size_t samples = 0;
+    for (size_t at = text.find(prefix); at != std::string::npos; at = text.find(prefix, at + 1)) {
+        size_t value = text.find("} ", at) + 2;
+        uint64_t current = std::strtoull(text.c_str() + value, nullptr, 10);
+        if (current < previous) {
+            return false;
+        }
+        previous = current;
+        samples++;
+    }
+    return samples > 0;
+}
+
+static void testCounters() {
+    Metrics::Registry registry;
+    registry.claimsSent.inc(3);
+    registry.audioSourceMedia.inc();
+    registry.audioSourceMedia.inc();
+    registry.connectFailures.inc();
+
+    // Prometheus text: the family carries the _total suffix
+    std::string text = registry.render(false);
+    CHECK(hasLine(text, "# TYPE airpods_handoff_claims_sent_total counter"));
+    CHECK(hasLine(text, "# HELP airpods_handoff_claims_sent_total OWNS_CONNECTION claims sent to the AirPods."));
+    CHECK(hasLine(text, "airpods_handoff_claims_sent_total 3"));
+    CHECK(hasLine(text, "airpods_handoff_audio_source_notifications_total{type=\"media\"} 2"));
+    CHECK(hasLine(text, "airpods_handoff_audio_source_notifications_total{type=\"none\"} 0"));
+    CHECK(hasLine(text, "airpods_handoff_failures_total{kind=\"connect\"} 1"));
+    CHECK(text.find("# EOF") == std::string::npos);
+
+    // OpenMetrics: the family drops the suffix, samples keep it
+    std::string open = registry.render(true);
+    CHECK(hasLine(open, "# TYPE airpods_handoff_claims_sent counter"));
+    CHECK(hasLine(open, "# HELP airpods_handoff_claims_sent OWNS_CONNECTION claims sent to the AirPods."));
+    CHECK(hasLine(open, "airpods_handoff_claims_sent_total 3"));
+    CHECK(hasLine(open, "# TYPE airpods_handoff_audio_source_notifications counter"));
+    CHECK(open.find("# TYPE airpods_handoff_claims_sent_total") == std::string::npos);
+
+    // Exactly one # EOF, and it is the last line
+    CHECK(occurrences(open, "# EOF") == 1);
+    CHECK(open.size() >= 6 && open.compare(open.size() - 6, 6, "# EOF\n") == 0);
+
+    // Each family is declared once in either format
+    CHECK(occurrences(text, "# TYPE airpods_handoff_reclaims_total ") == 1);
+    CHECK(occurrences(open, "# TYPE airpods_handoff_reclaims ") == 1);
+}
+
+static void testHistogram() {
+    Metrics::Registry registry;
+    registry.handoffLatency.observeUs(40000);     // le 0.05
+    registry.handoffLatency.observeUs(50000);     // On the bound, still le 0.05
+    registry.handoffLatency.observeUs(200000);    // le 0.25
+    registry.handoffLatency.observeUs(20000000);  // Past the last bound, only +Inf
+    CHECK(registry.handoffLatency.count() == 4);
+
+    const std::string family = "airpods_handoff_handoff_duration_seconds";
+    for (bool openMetrics : {false, true}) {
+        std::string text = registry.render(openMetrics);
+        CHECK(hasLine(text, "# TYPE " + family + " histogram"));
+        CHECK(hasLine(text, family + "_bucket{le=\"0.05\"} 2"));
+        CHECK(hasLine(text, family + "_bucket{le=\"0.1\"} 2"));
+        CHECK(hasLine(text, family + "_bucket{le=\"0.25\"} 3"));
+        CHECK(hasLine(text, family + "_bucket{le=\"10\"} 3"));
+        CHECK(hasLine(text, family + "_bucket{le=\"+Inf\"} 4"));
+        CHECK(hasLine(text, family + "_count 4"));
+        CHECK(hasLine(text, family + "_sum 20.290000"));
+        CHECK(bucketsAreCumulative(text, family));
+
+        // An empty histogram still exposes every bucket
+        CHECK(hasLine(text, "airpods_handoff_reconnect_duration_seconds_bucket{le=\"+Inf\"} 0"));
+        CHECK(hasLine(text, "airpods_handoff_reconnect_duration_seconds_count 0"));
+    }
+}
+
+int main() {
+    testCounters();
+    testHistogram();
+
+    return checkResult();
+}
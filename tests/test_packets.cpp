@@ -0,0 +1,102 @@
+// Packet encoding and AUDIO_SOURCE parsing
+
+#include "check.h"
+#include "core/packets.h"
+
+using Packets::Bytes;
+
+static const Bytes PHONE_MAC = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+
+static Bytes audioSource(uint8_t type) {
+    return {0x04, 0x00, 0x04, 0x00, 0x0E, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, type};
+}
+
+static void testParseAudioSource() {
+    auto info = Packets::AudioSource::parse(audioSource(0x02));
+    CHECK(info.isValid);
+    CHECK(info.deviceMac == PHONE_MAC);
+    CHECK(info.type == Packets::AudioSource::MEDIA);
+
+    CHECK(Packets::AudioSource::parse(audioSource(0x00)).type == Packets::AudioSource::NONE);
+    CHECK(Packets::AudioSource::parse(audioSource(0x01)).type == Packets::AudioSource::CALL);
+
+    // The byte between header and MAC is not interpreted
+    Bytes flagged = audioSource(0x02);
+    flagged[5] = 0x7f;
+    CHECK(Packets::AudioSource::parse(flagged).isValid);
+    CHECK(Packets::AudioSource::parse(flagged).deviceMac == PHONE_MAC);
+
+    // Trailing bytes are ignored
+    Bytes longer = audioSource(0x01);
+    longer.push_back(0xff);
+    CHECK(Packets::AudioSource::parse(longer).isValid);
+    CHECK(Packets::AudioSource::parse(longer).type == Packets::AudioSource::CALL);
+}
+
+static void testParseRejectsShortPackets() {
+    Bytes packet = audioSource(0x02);
+    for (size_t length = 0; length < packet.size(); length++) {
+        auto info = Packets::AudioSource::parse(Bytes(packet.begin(), packet.begin() + length));
+        CHECK(!info.isValid);
+        CHECK(info.deviceMac.empty());
+        CHECK(info.type == Packets::AudioSource::NONE);
+    }
+}
+
+static void testParseRejectsWrongHeader() {
+    for (size_t i = 0; i < Packets::AudioSource::HEADER.size(); i++) {
+        Bytes packet = audioSource(0x02);
+        packet[i] ^= 0x01;
+        CHECK(!Packets::AudioSource::parse(packet).isValid);
+    }
+
+    // FEATURES_ACK shares the AACP prefix but is a different opcode
+    Bytes ack = Packets::Connection::FEATURES_ACK;
+    ack.resize(13, 0x00);
+    CHECK(!Packets::AudioSource::parse(ack).isValid);
+}
+
+static void testCreateRoundTrips() {
+    Bytes packet = Packets::AudioSource::create(PHONE_MAC, Packets::AudioSource::CALL);
+    CHECK(packet == audioSource(0x01));
+
+    auto info = Packets::AudioSource::parse(packet);
+    CHECK(info.isValid);
+    CHECK(info.deviceMac == PHONE_MAC);
+    CHECK(info.type == Packets::AudioSource::CALL);
+}
+
+static void testOwnsConnection() {
+    CHECK(Packets::OwnsConnection::createCommand(0x06, 0x01) ==
+          Bytes({0x04, 0x00, 0x04, 0x00, 0x09, 0x00, 0x06, 0x01, 0x00, 0x00, 0x00}));
+    CHECK(Packets::OwnsConnection::createCommand(0xab, 0xcd) ==
+          Bytes({0x04, 0x00, 0x04, 0x00, 0x09, 0x00, 0xab, 0xcd, 0x00, 0x00, 0x00}));
+
+    CHECK(Packets::OwnsConnection::CLAIM ==
+          Bytes({0x04, 0x00, 0x04, 0x00, 0x09, 0x00, 0x06, 0x01, 0x00, 0x00, 0x00}));
+    CHECK(Packets::OwnsConnection::RELEASE ==
+          Bytes({0x04, 0x00, 0x04, 0x00, 0x09, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00}));
+    CHECK(Packets::startsWith(Packets::OwnsConnection::CLAIM, Packets::OwnsConnection::HEADER));
+}
+
+static void testHelpers() {
+    CHECK(Packets::toHex(Bytes()) == "");
+    CHECK(Packets::toHex(PHONE_MAC) == "112233445566");
+    CHECK(Packets::toHex(Bytes({0x00, 0x0f, 0xf0, 0xff})) == "000ff0ff");
+
+    CHECK(Packets::startsWith(PHONE_MAC, Bytes()));
+    CHECK(Packets::startsWith(PHONE_MAC, Bytes({0x11, 0x22})));
+    CHECK(!Packets::startsWith(PHONE_MAC, Bytes({0x22})));
+    CHECK(!Packets::startsWith(Bytes({0x11}), Bytes({0x11, 0x22})));
+}
+
+int main() {
+    testParseAudioSource();
+    testParseRejectsShortPackets();
+    testParseRejectsWrongHeader();
+    testCreateRoundTrips();
+    testOwnsConnection();
+    testHelpers();
+
+    return checkResult();
+}
@@ -0,0 +1,166 @@
+// Status page writer and reader on files in a scratch directory
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "check.h"
+#include "status/statuspage.h"
+
+static std::string directory;
+
+static bool exists(const std::string &path) {
+    struct stat st;
+    return ::lstat(path.c_str(), &st) == 0;
+}
+
+static void testReaderSeesPublishedSnapshot() {
+    std::string path = directory + "/published.status";
+    StatusPage::Writer writer(path);
+    CHECK(writer.isOpen());
+
+    writer.current().connectionState = StatusPage::CONNECTED;
+    writer.current().ownerValid = 1;
+    writer.current().ownerType = 2;
+    writer.current().claimsSent = 7;
+    writer.publish(1234);
+
+    StatusPage::Reader reader(path);
+    CHECK(reader.isOpen());
+    CHECK(reader.writerPid() == static_cast<int32_t>(getpid()));
+
+    StatusPage::Snapshot snapshot{};
+    CHECK(reader.read(snapshot));
+    CHECK(snapshot.connectionState == StatusPage::CONNECTED);
+    CHECK(snapshot.ownerValid == 1);
+    CHECK(snapshot.ownerType == 2);
+    CHECK(snapshot.claimsSent == 7);
+    CHECK(snapshot.updatedAtMs == 1234);
+
+    // Later publishes show up through the same mapping
+    writer.current().claimsSent = 8;
+    writer.publish(5678);
+    CHECK(reader.read(snapshot));
+    CHECK(snapshot.claimsSent == 8);
+    CHECK(snapshot.updatedAtMs == 5678);
+}
+
+static void testReaderRejectsForeignFiles() {
+    std::string path = directory + "/foreign.status";
+
+    // Too short
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0);
+    CHECK(::write(fd, "hello", 5) == 5);
+    CHECK(!StatusPage::Reader(path).isOpen());
+
+    // Long enough, but no magic
+    CHECK(ftruncate(fd, sizeof(StatusPage::Layout)) == 0);
+    CHECK(!StatusPage::Reader(path).isOpen());
+    ::close(fd);
+
+    // A page from a different format version
+    std::string versioned = directory + "/versioned.status";
+    StatusPage::Writer writer(versioned);
+    CHECK(writer.isOpen());
+    CHECK(StatusPage::Reader(versioned).isOpen());
+
+    uint32_t version = StatusPage::VERSION + 1;
+    fd = ::open(versioned.c_str(), O_RDWR);
+    CHECK(pwrite(fd, &version, sizeof(version), offsetof(StatusPage::Layout, version)) == sizeof(version));
+    ::close(fd);
+    StatusPage::Reader reader(versioned);
+    CHECK(!reader.isOpen());
+    CHECK(!reader.errorString().empty());
+
+    ::unlink(path.c_str());
+}
+
+static void testWriterRefusesSymlinks() {
+    std::string victim = directory + "/victim";
+    std::string link = directory + "/link.status";
+    int fd = ::open(victim.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0);
+    CHECK(::write(fd, "keep", 4) == 4);
+    ::close(fd);
+    CHECK(::symlink(victim.c_str(), link.c_str()) == 0);
+
+    {
+        StatusPage::Writer writer(link);
+        CHECK(!writer.isOpen());
+        CHECK(!writer.errorString().empty());
+    }
+
+    struct stat st;
+    CHECK(::stat(victim.c_str(), &st) == 0 && st.st_size == 4);
+    CHECK(exists(link));
+
+    ::unlink(link.c_str());
+    ::unlink(victim.c_str());
+}
+
+static void testWriterRemovesOnlyItsOwnPage() {
+    std::string path = directory + "/owned.status";
+
+    // An instance cleans up after itself
+    {
+        StatusPage::Writer writer(path);
+        CHECK(writer.isOpen());
+        CHECK(exists(path));
+    }
+    CHECK(!exists(path));
+
+    // The file was replaced while we ran, e.g. by a second instance
+    {
+        auto original = std::make_unique<StatusPage::Writer>(path);
+        CHECK(original->isOpen());
+        ::unlink(path.c_str());
+        StatusPage::Writer current(path);
+        CHECK(current.isOpen());
+
+        original.reset();
+        CHECK(exists(path));
+    }
+    CHECK(!exists(path));
+
+    // Another process took the same file over, e.g. an overlapping restart
+    {
+        StatusPage::Writer writer(path);
+        CHECK(writer.isOpen());
+
+        pid_t child = fork();
+        if (child == 0) {
+            StatusPage::Writer takeover(path);
+            _exit(takeover.isOpen() ? 0 : 1);  // Exits without running the destructor
+        }
+        int status = 0;
+        CHECK(waitpid(child, &status, 0) == child);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        StatusPage::Reader reader(path);
+        CHECK(reader.writerPid() == static_cast<int32_t>(child));
+    }
+    CHECK(exists(path));
+    ::unlink(path.c_str());
+}
+
+int main() {
+    char scratch[] = "/tmp/test-statuspage-XXXXXX";
+    if (!mkdtemp(scratch)) {
+        return 1;
+    }
+    directory = scratch;
+
+    testReaderSeesPublishedSnapshot();
+    testReaderRejectsForeignFiles();
+    testWriterRefusesSymlinks();
+    testWriterRemovesOnlyItsOwnPage();
+
+    ::rmdir(directory.c_str());
+    return checkResult();
+}
@@ -0,0 +1,88 @@
+// Tiny reader for the airpods-handoff status page.
+//
+// Prints one key=value pair per line so status bars can consume it without
+// talking to the daemon:
+//   airpods-handoff-status [status-file]
+// Without an argument it reads $XDG_RUNTIME_DIR/airpods-handoff.status, or
+// the system service's page when there is none.
+
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <signal.h>
+#include <unistd.h>
+#include "status/statuspage.h"
+
+static const char *connectionStateName(uint8_t state) {
+    switch (state) {
+        case StatusPage::CONNECTING: return "connecting";
+        case StatusPage::CONNECTED: return "connected";
+        default: return "disconnected";
+    }
+}
+
+static const char *ownerTypeName(uint8_t type) {
+    // Values match Packets::AudioSource::Type
+    switch (type) {
+        case 0x01: return "call";
+        case 0x02: return "media";
+        default: return "none";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+        std::fprintf(stderr, "Usage: %s [status-file]\n", argv[0]);
+        std::fprintf(stderr, "Default: $XDG_RUNTIME_DIR/airpods-handoff.status, then %s\n", StatusPage::SYSTEM_PATH);
+        return 2;
+    }
+
+    std::string path = argc == 2 ? argv[1] : StatusPage::defaultPath();
+    if (argc < 2 && (path.empty() || access(path.c_str(), F_OK) != 0)) {
+        path = StatusPage::SYSTEM_PATH;
+    }
+
+    StatusPage::Reader reader(path);
+    if (!reader.isOpen()) {
+        std::fprintf(stderr, "%s\n", reader.errorString().c_str());
+        return 1;
+    }
+
+    // A daemon killed by a signal can't remove its page
+    if (kill(reader.writerPid(), 0) != 0 && errno == ESRCH) {
+        std::fprintf(stderr, "airpods-handoff (pid %d) is not running\n", reader.writerPid());
+        return 1;
+    }
+
+    StatusPage::Snapshot status;
+    if (!reader.read(status)) {
+        std::fprintf(stderr, "Could not get a consistent snapshot\n");
+        return 1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    long long nowMs = static_cast<long long>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+
+    std::printf("pid=%d\n", reader.writerPid());
+    std::printf("state=%s\n", connectionStateName(status.connectionState));
+    if (status.ownerValid) {
+        const uint8_t *mac = status.ownerMac;
+        std::printf("owner=%02X:%02X:%02X:%02X:%02X:%02X\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        std::printf("owner_type=%s\n", ownerTypeName(status.ownerType));
+        std::printf("owner_local=%d\n", status.ownerIsLocal ? 1 : 0);
+    } else {
+        std::printf("owner=\n");
+        std::printf("owner_type=none\n");
+        std::printf("owner_local=0\n");
+    }
+    std::printf("last_handoff_ms=%.1f\n", status.lastHandoffUs / 1000.0);
+    std::printf("audio_source_notifications=%llu\n", static_cast<unsigned long long>(status.audioSourceNotifications));
+    std::printf("claims_sent=%llu\n", static_cast<unsigned long long>(status.claimsSent));
+    std::printf("handoffs=%llu\n", static_cast<unsigned long long>(status.handoffs));
+    std::printf("reconnect_attempts=%llu\n", static_cast<unsigned long long>(status.reconnectAttempts));
+    std::printf("disconnects=%llu\n", static_cast<unsigned long long>(status.disconnects));
+    std::printf("updated_ms_ago=%lld\n", nowMs - static_cast<long long>(status.updatedAtMs));
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+// Transport benchmark.
+//
+// Against real AirPods, compares the QBluetoothSocket and raw L2CAP paths:
+//   airpods-handoff-transport-bench [--transport qt|l2cap] [--rounds N] <AirPods_MAC_Address>
+// Each round connects, performs the AACP handshake and times connect and
+// REQUEST_NOTIFICATIONS -> first AUDIO_SOURCE.
+//
+// Without hardware, measures the raw L2CAP receive path against a socketpair:
+//   airpods-handoff-transport-bench --socketpair [--packets N] [--burst N] [--batch N] [--max-packet BYTES]
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "clock/systemclock.h"
+#include "core/packets.h"
+#include "transport/bluetoothtransport.h"
+#include "transport/l2captransport.h"
+
+QString getTimestamp() {
+    return QDateTime::currentDateTime().toString("HH:mm:ss.zzz");
+}
+
+static int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void printDistribution(const char *name, std::vector<double> samples, const char *unit) {
+    if (samples.empty()) {
+        std::cout << name << ": no samples" << std::endl;
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) { return samples[static_cast<size_t>(q * (samples.size() - 1))]; };
+    std::cout << name << ": n=" << samples.size() << " min=" << samples.front() << unit
+              << " p50=" << at(0.5) << unit << " p99=" << at(0.99) << unit
+              << " max=" << samples.back() << unit << std::endl;
+}
+
+// Connect/handshake rounds against real AirPods
+class DeviceBench : public QObject {
+    Q_OBJECT
+
+public:
+    DeviceBench(Transport *transport, Clock &clock, const QString &mac, int rounds)
+        : transport(transport), clock(clock), mac(mac), rounds(rounds)
+    {
+        connect(transport, &Transport::connected, this, &DeviceBench::onConnected);
+        connect(transport, &Transport::packetReceived, this, &DeviceBench::onPacket);
+        connect(transport, &Transport::connectFailed, this, [this]() { finishRound(false); });
+        connect(transport, &Transport::disconnected, this, [this]() {
+            if (roundActive) {
+                finishRound(false);
+            }
+        });
+    }
+
+    void start() { startRound(); }
+
+private slots:
+    void onConnected() {
+        connectMs.push_back((clock.monotonicUs() - roundStartedUs) / 1000.0);
+        transport->send(toQByteArray(Packets::Connection::HANDSHAKE));
+    }
+
+    void onPacket(const QByteArray &packet) {
+        if (packet.startsWith(toQByteArray(Packets::Connection::FEATURES_ACK))) {
+            requestedUs = clock.monotonicUs();
+            transport->send(toQByteArray(Packets::Connection::REQUEST_NOTIFICATIONS));
+        } else if (requestedUs > 0 && packet.startsWith(toQByteArray(Packets::AudioSource::HEADER))) {
+            notificationMs.push_back((clock.monotonicUs() - requestedUs) / 1000.0);
+            finishRound(true);
+        }
+    }
+
+private:
+    void startRound() {
+        if (round == rounds) {
+            report();
+            QCoreApplication::quit();
+            return;
+        }
+
+        round++;
+        roundActive = true;
+        requestedUs = 0;
+        roundStartedUs = clock.monotonicUs();
+        timeoutTimer = clock.startTimer(15000, [this]() {
+            timeoutTimer = 0;
+            finishRound(false);
+        });
+        transport->connectToDevice(mac);
+    }
+
+    void finishRound(bool ok) {
+        if (!roundActive) {
+            return;
+        }
+        roundActive = false;
+        clock.cancelTimer(timeoutTimer);
+        timeoutTimer = 0;
+        if (!ok) {
+            failures++;
+        }
+        transport->disconnectFromDevice();
+
+        // Give the link a moment to go down before the next round
+        clock.startTimer(1000, [this]() { startRound(); });
+    }
+
+    void report() {
+        std::cout << "rounds=" << rounds << " failures=" << failures << std::endl;
+        printDistribution("connect", connectMs, "ms");
+        printDistribution("request->notification", notificationMs, "ms");
+    }
+
+    Transport *transport;
+    Clock &clock;
+    QString mac;
+    int rounds;
+    int round = 0;
+    int failures = 0;
+    bool roundActive = false;
+    int64_t roundStartedUs = 0;
+    int64_t requestedUs = 0;
+    Clock::TimerId timeoutTimer = 0;
+    std::vector<double> connectMs;
+    std::vector<double> notificationMs;
+};
+
+// Receive latency of the raw transport, fed by a thread on the other end of a socketpair
+static int runSocketpair(Clock &clock, const L2capTransport::Options &options, int packets, int burst) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+        std::cerr << "socketpair: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    L2capTransport transport(clock, options);
+    std::vector<double> latencyUs;
+    latencyUs.reserve(packets);
+
+    QObject::connect(&transport, &Transport::packetReceived, [&](const QByteArray &packet) {
+        int64_t sentNs;
+        const qsizetype offset = static_cast<qsizetype>(Packets::AudioSource::HEADER.size());
+        if (packet.size() < offset + static_cast<qsizetype>(sizeof(sentNs))) {
+            return;
+        }
+        std::memcpy(&sentNs, packet.constData() + offset, sizeof(sentNs));
+        latencyUs.push_back((steadyNowNs() - sentNs) / 1000.0);
+        if (static_cast<int>(latencyUs.size()) == packets) {
+            QCoreApplication::quit();
+        }
+    });
+
+    if (!transport.adoptDescriptor(fds[0])) {
+        std::cerr << "Failed to adopt socketpair descriptor" << std::endl;
+        return 1;
+    }
+
+    int64_t startedNs = steadyNowNs();
+    std::thread peer([fd = fds[1], packets, burst]() {
+        for (int sent = 0; sent < packets; ) {
+            for (int i = 0; i < burst && sent < packets; i++, sent++) {
+                QByteArray packet = toQByteArray(Packets::AudioSource::HEADER);
+                int64_t now = steadyNowNs();
+                packet.append(reinterpret_cast<const char *>(&now), sizeof(now));
+                ::send(fd, packet.constData(), packet.size(), MSG_NOSIGNAL);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    });
+
+    QCoreApplication::exec();
+    peer.join();
+    ::close(fds[1]);
+
+    double elapsedMs = (steadyNowNs() - startedNs) / 1e6;
+    std::cout << "packets=" << latencyUs.size() << " burst=" << burst << " batch=" << options.batchSize
+              << " elapsed=" << elapsedMs << "ms" << std::endl;
+    printDistribution("receive latency", latencyUs, "us");
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QString mac;
+    bool rawL2cap = false;
+    bool socketpairMode = false;
+    int rounds = 10;
+    int packets = 10000;
+    int burst = 8;
+    L2capTransport::Options options;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--transport") == 0 && hasValue) {
+            rawL2cap = std::strcmp(argv[++i], "l2cap") == 0;
+        } else if (std::strcmp(arg, "--rounds") == 0 && hasValue) {
+            rounds = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--socketpair") == 0) {
+            socketpairMode = true;
+        } else if (std::strcmp(arg, "--packets") == 0 && hasValue) {
+            packets = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--burst") == 0 && hasValue) {
+            burst = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--batch") == 0 && hasValue) {
+            options.batchSize = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--max-packet") == 0 && hasValue) {
+            options.maxPacketSize = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--rcvbuf") == 0 && hasValue) {
+            options.receiveBufferSize = std::atoi(argv[++i]);
+        } else if (arg[0] != '-' && mac.isEmpty()) {
+            mac = QString(arg);
+        } else {
+            mac.clear();
+            socketpairMode = false;
+            break;
+        }
+    }
+
+    SystemClock clock;
+
+    if (socketpairMode) {
+        return runSocketpair(clock, options, packets, burst);
+    }
+
+    if (mac.isEmpty()) {
+        std::cerr << "Usage: " << argv[0] << " [--transport qt|l2cap] [--rounds N] [--rcvbuf BYTES] <AirPods_MAC_Address>" << std::endl;
+        std::cerr << "       " << argv[0] << " --socketpair [--packets N] [--burst N] [--batch N] [--max-packet BYTES] [--rcvbuf BYTES]" << std::endl;
+        return 1;
+    }
+
+    Transport *transport = rawL2cap ? static_cast<Transport *>(new L2capTransport(clock, options))
+                                    : static_cast<Transport *>(new BluetoothTransport());
+    std::cout << "transport=" << (rawL2cap ? "l2cap" : "qt") << std::endl;
+
+    DeviceBench bench(transport, clock, mac, rounds);
+    bench.start();
+    int result = app.exec();
+
+    delete transport;
+    return result;
+}
+
+#include "transport-bench.moc"
@@ -0,0 +1,114 @@
+#include "bluetoothtransport.h"
+
+#include <QBluetoothAddress>
+#include <QBluetoothUuid>
+#include <iostream>
+
+extern QString getTimestamp();
+
+void BluetoothTransport::connectToDevice(const QString &macAddress)
+{
+    // Clean up old socket if it exists
+    if (socket) {
+        socket->disconnect();
+        socket->deleteLater();
+    }
+
+    socket = new QBluetoothSocket(QBluetoothServiceInfo::L2capProtocol, this);
+
+    connect(socket, &QBluetoothSocket::connected, this, &Transport::connected);
+    connect(socket, &QBluetoothSocket::readyRead, this, &BluetoothTransport::onDataReceived);
+    connect(socket, &QBluetoothSocket::disconnected, this, &Transport::disconnected);
+    connect(socket, QOverload<QBluetoothSocket::SocketError>::of(&QBluetoothSocket::errorOccurred),
+            this, &BluetoothTransport::onError);
+    connect(socket, &QBluetoothSocket::stateChanged, this, &BluetoothTransport::onStateChanged);
+
+    // Connect to AirPods AACP service
+    QBluetoothAddress addr(macAddress);
+    socket->connectToService(addr, QBluetoothUuid("74ec2172-0bad-4d01-8f77-997b2be0722a"));
+}
+
+void BluetoothTransport::disconnectFromDevice()
+{
+    if (socket) {
+        socket->disconnectFromService();
+    }
+}
+
+bool BluetoothTransport::isConnected() const
+{
+    return socket && socket->isOpen() && socket->state() == QBluetoothSocket::SocketState::ConnectedState;
+}
+
+qint64 BluetoothTransport::send(const QByteArray &packet)
+{
+    return socket ? socket->write(packet) : -1;
+}
+
+void BluetoothTransport::onDataReceived()
+{
+    QByteArray data = socket->readAll();
+
+    // Debug: log all received data (commented out - uncomment for debugging)
+    // if (data.size() > 0) {
+    //     std::cout << "[Handoff] Received packet: " << data.toHex().toStdString() << std::endl;
+    // }
+
+    emit packetReceived(data);
+}
+
+void BluetoothTransport::onStateChanged(QBluetoothSocket::SocketState state)
+{
+    QString stateStr;
+    switch (state) {
+        case QBluetoothSocket::SocketState::UnconnectedState:
+            stateStr = "Unconnected";
+            break;
+        case QBluetoothSocket::SocketState::ServiceLookupState:
+            stateStr = "ServiceLookup";
+            break;
+        case QBluetoothSocket::SocketState::ConnectingState:
+            stateStr = "Connecting";
+            break;
+        case QBluetoothSocket::SocketState::ConnectedState:
+            stateStr = "Connected";
+            break;
+        case QBluetoothSocket::SocketState::ClosingState:
+            stateStr = "Closing";
+            break;
+        default:
+            stateStr = "Unknown";
+    }
+    std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Socket state: " << stateStr.toStdString() << std::endl;
+}
+
+void BluetoothTransport::onError(QBluetoothSocket::SocketError error)
+{
+    std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] Socket error: " << static_cast<int>(error);
+
+    // Log error type for debugging
+    switch (error) {
+        case QBluetoothSocket::SocketError::ServiceNotFoundError:
+            std::cerr << " (ServiceNotFoundError)" << std::endl;
+            break;
+        case QBluetoothSocket::SocketError::HostNotFoundError:
+            std::cerr << " (HostNotFoundError)" << std::endl;
+            break;
+        case QBluetoothSocket::SocketError::NetworkError:
+            std::cerr << " (NetworkError)" << std::endl;
+            break;
+        case QBluetoothSocket::SocketError::UnknownSocketError:
+            std::cerr << " (UnknownSocketError)" << std::endl;
+            break;
+        default:
+            std::cerr << std::endl;
+    }
+
+    // If we get an error during connection attempt, schedule reconnection
+    // (errors during active connection will trigger onDisconnected instead)
+    if (error == QBluetoothSocket::SocketError::ServiceNotFoundError ||
+        error == QBluetoothSocket::SocketError::HostNotFoundError ||
+        error == QBluetoothSocket::SocketError::NetworkError) {
+        emit connectFailed();
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef BLUETOOTHTRANSPORT_H
+#define BLUETOOTHTRANSPORT_H
+
+#include <QBluetoothSocket>
+#include "transport.h"
+
+// AACP over QBluetoothSocket, looked up by service UUID
+class BluetoothTransport : public Transport {
+    Q_OBJECT
+
+public:
+    using Transport::Transport;
+
+    void connectToDevice(const QString &macAddress) override;
+    void disconnectFromDevice() override;
+    bool isConnected() const override;
+    qint64 send(const QByteArray &packet) override;
+
+private slots:
+    void onDataReceived();
+    void onStateChanged(QBluetoothSocket::SocketState state);
+    void onError(QBluetoothSocket::SocketError error);
+
+private:
+    QBluetoothSocket *socket = nullptr;
+};
+
+#endif // BLUETOOTHTRANSPORT_H
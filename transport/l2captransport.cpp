@@ -0,0 +1,294 @@
+#include "l2captransport.h"
+
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QtEndian>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern QString getTimestamp();
+
+namespace {
+    // From <bluetooth/bluetooth.h> and <bluetooth/l2cap.h>, spelled out so
+    // building doesn't need the BlueZ development headers
+    constexpr int BLUETOOTH_FAMILY = 31;  // AF_BLUETOOTH
+    constexpr int L2CAP_PROTOCOL = 0;     // BTPROTO_L2CAP
+
+    struct L2capAddress {
+        sa_family_t family;
+        quint16 psm;           // Little endian
+        quint8 bdaddr[6];      // Little endian, last octet of the printed MAC first
+        quint16 cid;
+        quint8 bdaddrType;     // BDADDR_BREDR
+    };
+
+    bool parseAddress(const QString &macAddress, quint8 bdaddr[6]) {
+        QStringList octets = macAddress.split(':');
+        if (octets.size() != 6) {
+            return false;
+        }
+        for (int i = 0; i < 6; i++) {
+            bool ok = false;
+            uint value = octets[i].toUInt(&ok, 16);
+            if (!ok || value > 0xff) {
+                return false;
+            }
+            bdaddr[5 - i] = static_cast<quint8>(value);
+        }
+        return true;
+    }
+}
+
+L2capTransport::L2capTransport(Clock &clock, const Options &options, QObject *parent)
+    : Transport(parent), clock(clock), options(options)
+{
+    this->options.batchSize = qMax(1, options.batchSize);
+    this->options.maxPacketSize = qMax(64, options.maxPacketSize);
+    buffer.resize(this->options.batchSize * this->options.maxPacketSize);
+}
+
+L2capTransport::~L2capTransport()
+{
+    closeSocket();
+}
+
+void L2capTransport::connectToDevice(const QString &macAddress)
+{
+    closeSocket();
+
+    L2capAddress address{};
+    address.family = BLUETOOTH_FAMILY;
+    address.psm = qToLittleEndian<quint16>(AACP_PSM);
+    if (!parseAddress(macAddress, address.bdaddr)) {
+        failConnect("invalid address", EINVAL);
+        return;
+    }
+
+    connectStartedUs = clock.monotonicUs();
+
+    fd = ::socket(BLUETOOTH_FAMILY, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, L2CAP_PROTOCOL);
+    if (fd < 0) {
+        failConnect("socket", errno);
+        return;
+    }
+
+    if (!applyOptions(fd)) {
+        failConnect("setsockopt", errno);
+        return;
+    }
+
+    state = CONNECTING;
+    std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Socket state: Connecting (L2CAP PSM 0x"
+              << std::hex << AACP_PSM << std::dec << ")" << std::endl;
+
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0) {
+        onWritable();
+        return;
+    }
+    if (errno != EINPROGRESS) {
+        failConnect("connect", errno);
+        return;
+    }
+
+    // Completion is signalled by the socket becoming writable
+    writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+    connect(writeNotifier, &QSocketNotifier::activated, this, &L2capTransport::onWritable);
+
+    if (options.connectTimeoutMs > 0) {
+        connectTimer = clock.startTimer(options.connectTimeoutMs, [this]() {
+            connectTimer = 0;
+            failConnect("connect", ETIMEDOUT);
+        });
+    }
+}
+
+void L2capTransport::disconnectFromDevice()
+{
+    bool wasConnected = state == CONNECTED;
+    closeSocket();
+    if (wasConnected) {
+        emit disconnected();
+    }
+}
+
+bool L2capTransport::isConnected() const
+{
+    return state == CONNECTED;
+}
+
+qint64 L2capTransport::send(const QByteArray &packet)
+{
+    if (state != CONNECTED) {
+        return -1;
+    }
+
+    ssize_t written;
+    do {
+        written = ::send(fd, packet.constData(), packet.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (written < 0 && errno == EINTR);
+
+    return written;
+}
+
+bool L2capTransport::adoptDescriptor(int descriptor)
+{
+    closeSocket();
+
+    int flags = fcntl(descriptor, F_GETFL);
+    if (flags < 0 || fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) < 0 || !applyOptions(descriptor)) {
+        int error = errno;
+        ::close(descriptor);
+        errno = error;
+        return false;
+    }
+
+    fd = descriptor;
+    state = CONNECTED;
+    watch(fd);
+    emit connected();
+    return true;
+}
+
+bool L2capTransport::applyOptions(int descriptor)
+{
+    if (options.receiveBufferSize > 0 &&
+        setsockopt(descriptor, SOL_SOCKET, SO_RCVBUF, &options.receiveBufferSize, sizeof(int)) != 0) {
+        return false;
+    }
+    if (options.sendBufferSize > 0 &&
+        setsockopt(descriptor, SOL_SOCKET, SO_SNDBUF, &options.sendBufferSize, sizeof(int)) != 0) {
+        return false;
+    }
+    return true;
+}
+
+void L2capTransport::watch(int descriptor)
+{
+    readNotifier = new QSocketNotifier(descriptor, QSocketNotifier::Read, this);
+    connect(readNotifier, &QSocketNotifier::activated, this, &L2capTransport::onReadable);
+}
+
+void L2capTransport::onWritable()
+{
+    if (state != CONNECTING) {
+        return;
+    }
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0) {
+        error = errno;
+    }
+    if (error != 0) {
+        failConnect("connect", error);
+        return;
+    }
+
+    clock.cancelTimer(connectTimer);
+    connectTimer = 0;
+    releaseNotifier(writeNotifier);
+
+    state = CONNECTED;
+    connectTimeMs = (clock.monotonicUs() - connectStartedUs) / 1000;
+    std::cout << "[" << getTimestamp().toStdString() << "] [Handoff] Socket state: Connected (" << connectTimeMs << " ms)" << std::endl;
+
+    watch(fd);
+    emit connected();
+}
+
+void L2capTransport::onReadable()
+{
+    const int batch = options.batchSize;
+    const int slot = options.maxPacketSize;
+
+    QVector<mmsghdr> messages(batch);
+    QVector<iovec> vectors(batch);
+
+    // Drain everything that is queued, a full batch means there may be more
+    while (state == CONNECTED) {
+        for (int i = 0; i < batch; i++) {
+            vectors[i].iov_base = buffer.data() + i * slot;
+            vectors[i].iov_len = slot;
+            std::memset(&messages[i], 0, sizeof(mmsghdr));
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int received = recvmmsg(fd, messages.data(), batch, MSG_DONTWAIT, nullptr);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] Socket error: " << std::strerror(errno) << std::endl;
+            disconnectFromDevice();
+            return;
+        }
+
+        for (int i = 0; i < received; i++) {
+            unsigned int length = messages[i].msg_len;
+
+            // A zero-length read on a SEQPACKET socket is an orderly shutdown
+            if (length == 0) {
+                disconnectFromDevice();
+                return;
+            }
+
+            // An oversized datagram was cut to the slot size; never parse the fragment
+            if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] Dropped datagram larger than "
+                          << slot << " bytes (raise --max-packet)" << std::endl;
+                continue;
+            }
+
+            emit packetReceived(QByteArray(buffer.constData() + i * slot, static_cast<int>(length)));
+
+            // A slot may have closed the socket
+            if (state != CONNECTED) {
+                return;
+            }
+        }
+
+        if (received < batch) {
+            return;
+        }
+    }
+}
+
+void L2capTransport::failConnect(const char *what, int error)
+{
+    std::cerr << "[" << getTimestamp().toStdString() << "] [Handoff] Socket error: " << what << ": " << std::strerror(error) << std::endl;
+    closeSocket();
+    emit connectFailed();
+}
+
+void L2capTransport::releaseNotifier(QSocketNotifier *&notifier)
+{
+    // We may be inside its activated() signal
+    if (notifier) {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+        notifier = nullptr;
+    }
+}
+
+void L2capTransport::closeSocket()
+{
+    clock.cancelTimer(connectTimer);
+    connectTimer = 0;
+
+    releaseNotifier(readNotifier);
+    releaseNotifier(writeNotifier);
+
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    state = UNCONNECTED;
+}
@@ -0,0 +1,71 @@
+#ifndef L2CAPTRANSPORT_H
+#define L2CAPTRANSPORT_H
+
+#include <QVector>
+#include "transport.h"
+#include "clock/clock.h"
+
+class QSocketNotifier;
+
+// AACP over a raw AF_BLUETOOTH L2CAP socket.
+//
+// Connects straight to the AACP PSM, skipping SDP service lookup and
+// QBluetoothSocket's buffering. The non-blocking fd is watched by the Qt event
+// loop and every wakeup drains all queued datagrams with recvmmsg().
+class L2capTransport : public Transport {
+    Q_OBJECT
+
+public:
+    static constexpr quint16 AACP_PSM = 0x1001;
+
+    struct Options {
+        int receiveBufferSize = 0;   // SO_RCVBUF in bytes, 0 keeps the kernel default
+        int sendBufferSize = 0;      // SO_SNDBUF in bytes, 0 keeps the kernel default
+        int connectTimeoutMs = 10000;
+        int batchSize = 16;          // Datagrams per recvmmsg() call
+        int maxPacketSize = 1024;    // Larger datagrams are logged and dropped, at least 64
+    };
+
+    L2capTransport(Clock &clock, const Options &options, QObject *parent = nullptr);
+    ~L2capTransport() override;
+
+    void connectToDevice(const QString &macAddress) override;
+    void disconnectFromDevice() override;
+    bool isConnected() const override;
+    qint64 send(const QByteArray &packet) override;
+
+    // Take ownership of an already connected SOCK_SEQPACKET fd, e.g. one end
+    // of a socketpair() standing in for the AirPods. Emits connected().
+    // The fd is closed if it can't be set up, in which case errno is set and
+    // nothing is emitted.
+    bool adoptDescriptor(int fd);
+
+    // Milliseconds from connectToDevice() to connected(), -1 before the first connect
+    qint64 lastConnectTimeMs() const { return connectTimeMs; }
+
+private slots:
+    void onReadable();
+    void onWritable();
+
+private:
+    enum State { UNCONNECTED, CONNECTING, CONNECTED };
+
+    bool applyOptions(int fd);
+    void watch(int fd);
+    void failConnect(const char *what, int error);
+    void releaseNotifier(QSocketNotifier *&notifier);
+    void closeSocket();
+
+    Clock &clock;
+    Options options;
+    int fd = -1;
+    State state = UNCONNECTED;
+    QSocketNotifier *readNotifier = nullptr;
+    QSocketNotifier *writeNotifier = nullptr;
+    Clock::TimerId connectTimer = 0;
+    int64_t connectStartedUs = 0;
+    qint64 connectTimeMs = -1;
+    QVector<char> buffer;  // batchSize slots of maxPacketSize bytes
+};
+
+#endif // L2CAPTRANSPORT_H
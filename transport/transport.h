@@ -0,0 +1,43 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include "core/packets.h"
+
+// Packet link to the AirPods AACP service.
+//
+// Implementations deliver whole datagrams through packetReceived() and report
+// failed connection attempts through connectFailed(). A connection that was
+// established and then lost emits disconnected() instead.
+class Transport : public QObject {
+    Q_OBJECT
+
+public:
+    using QObject::QObject;
+
+    virtual void connectToDevice(const QString &macAddress) = 0;
+    virtual void disconnectFromDevice() = 0;
+    virtual bool isConnected() const = 0;
+
+    // Returns the number of bytes written or -1
+    virtual qint64 send(const QByteArray &packet) = 0;
+
+signals:
+    void connected();
+    void disconnected();
+    void connectFailed();
+    void packetReceived(const QByteArray &packet);
+};
+
+// Conversions between Qt and core packet buffers
+inline QByteArray toQByteArray(const Packets::Bytes &bytes) {
+    return QByteArray(reinterpret_cast<const char *>(bytes.data()), static_cast<qsizetype>(bytes.size()));
+}
+
+inline Packets::Bytes toBytes(const QByteArray &data) {
+    return Packets::Bytes(data.constBegin(), data.constEnd());
+}
+
+#endif // TRANSPORT_H